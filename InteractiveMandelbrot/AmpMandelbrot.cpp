@@ -0,0 +1,206 @@
+#include "AmpMandelbrot.h"
+#include <vector>
+#include "complex_amp.h"
+
+AmpMandelbrot::AmpMandelbrot()
+{
+	max_iter = 500;
+	skipped_pixels = 0;
+	tile_size = TS;
+}
+
+AmpMandelbrot::~AmpMandelbrot()
+{
+}
+
+// Set the maximum number of iterations before a point is assumed to be in the set
+void AmpMandelbrot::setMaxIterations(int max_iterations)
+{
+	max_iter = max_iterations;
+} // setMaxIterations
+
+// Only 4, 8, 16 and 32 have a kernel compiled for them, anything else goes back to TS
+void AmpMandelbrot::setTileSize(int size)
+{
+	tile_size = (size == 4 || size == 8 || size == 16 || size == 32) ? size : TS;
+} // setTileSize
+
+int AmpMandelbrot::tileSize() const
+{
+	return tile_size;
+} // tileSize
+
+// Generate mandelbrot set on GPU using amp
+void AmpMandelbrot::gpu_amp_mandelbrot(unsigned* counts, int width, int height, int stride, const Viewport& view)
+{
+	float left_, right_, top_, bottom_;
+	viewport_edges(view, left_, right_, top_, bottom_);
+
+	// Local copies, a restrict(amp) lambda can't capture this
+	unsigned max_iter = this->max_iter;
+	unsigned w = width;
+	unsigned h = height;
+	unsigned *pCounts = counts;
+
+	// View the whole buffer including the row padding, then work on the w x h part of it
+	array_view<unsigned, 2> frame(h, stride, pCounts);
+	array_view<unsigned, 2> a = frame.section(0, 0, h, w);
+	a.discard_data();
+
+	// Pixels skipped by the cardioid/bulb test, one counter per row so the
+	// atomics don't all land on the same address
+	std::vector<unsigned> row_skips(h, 0);
+	array_view<unsigned, 1> skips(h, row_skips);
+
+	parallel_for_each(a.extent, [=](index<2> idx) restrict(amp)
+	{
+		//USE THREAD ID/INDEX TO MAP INTO THE COMPLEX PLANE
+		int x = idx[1];
+		int y = idx[0];
+
+		// Work out the point in the complex plane that
+		// corresponds to this pixel in the output image.
+		Complex1 c = { left_ + (x * (right_ - left_) / w), top_ + (y * (bottom_ - top_) / h) };
+
+		// Start off z at (0, 0).
+		Complex1 z = { 0.0, 0.0 };
+
+		int iterations = 0;
+		if (c_in_cardioid_or_bulb(c))
+		{
+			// Inside the main cardioid or period-2 bulb, z never escapes so skip the loop
+			iterations = max_iter;
+			atomic_fetch_add(&skips[y], 1);
+		}
+
+		// Iterate z = z^2 + c until z moves more than 2 units
+		// away from (0, 0), or we've iterated too many times.
+		while (c_abs(z) < 2.0 && iterations < max_iter)
+		{
+			z = c_add(c_mul(z, z), c);
+
+			++iterations;
+		}
+
+		// max_iter means z never escaped, the point is in the set
+		a[y][x] = iterations;
+	});
+	a.synchronize();
+	skips.synchronize();
+
+	skipped_pixels = 0;
+	for (unsigned y = 0; y < h; y++)
+	{
+		skipped_pixels += row_skips[y];
+	}
+} // gpu_amp_mandelbrot
+
+// Tiled kernel for one tile size, the size has to be known at compile time.
+// Returns the number of pixels skipped by the cardioid/bulb test.
+template <int TILE>
+static long long amp_mandelbrot_tiled(unsigned* counts, int width, int height, int stride, unsigned max_iter, float left_, float right_, float top_, float bottom_)
+{
+	unsigned w = width;
+	unsigned h = height;
+	unsigned *pCounts = counts;
+	extent<2> e(h, w);
+	array_view<unsigned, 2> frame(h, stride, pCounts);
+	array_view<unsigned, 2> a = frame.section(index<2>(0, 0), e);
+	a.discard_data();
+
+	// Pixels skipped by the cardioid/bulb test, summed per tile then added once
+	unsigned total_skips = 0;
+	array_view<unsigned, 1> skips(1, &total_skips);
+
+	// Round the extent up to whole tiles, any size of frame can then be computed tiled
+	parallel_for_each(a.extent.tile<TILE, TILE>().pad(), [=](tiled_index<TILE, TILE> t_idx) restrict(amp)
+	{
+		//USE THREAD ID/INDEX TO MAP INTO THE COMPLEX PLANE
+		index<2> idx = t_idx.global;
+		int x = t_idx.global[1];
+		int y = t_idx.global[0];
+		// Padding threads past the edge of the frame only take part in the barriers
+		bool in_frame = x < (int)w && y < (int)h;
+
+		tile_static unsigned tile_skips;
+		if (t_idx.local[0] == 0 && t_idx.local[1] == 0)
+		{
+			tile_skips = 0;
+		}
+		t_idx.barrier.wait();
+
+		 /*Work out the point in the complex plane that
+		 corresponds to this pixel in the output image.*/
+		Complex1 c = { left_ + (x * (right_ - left_) / w), top_ + (y * (bottom_ - top_) / h) };
+
+		// Start off z at (0, 0).
+		Complex1 z = { 0.0, 0.0 };
+
+		int iterations = 0;
+		if (!in_frame)
+		{
+			iterations = max_iter;
+		}
+		else if (c_in_cardioid_or_bulb(c))
+		{
+			// Inside the main cardioid or period-2 bulb, z never escapes so skip the loop
+			iterations = max_iter;
+			atomic_fetch_add(&tile_skips, 1);
+		}
+
+		// Iterate z = z^2 + c until z moves more than 2 units
+		// away from (0, 0), or we've iterated too many times.
+		while (c_abs(z) < 2.0 && iterations < max_iter)
+		{
+			z = c_add(c_mul(z, z), c);
+
+			++iterations;
+		}
+
+		// max_iter means z never escaped, the point is in the set.
+		// Padding threads past the edge of the frame have nothing to write
+		if (in_frame)
+		{
+			a[y][x] = iterations;
+		}
+
+		// One thread per tile adds the tile's count to the total
+		t_idx.barrier.wait();
+		if (t_idx.local[0] == 0 && t_idx.local[1] == 0)
+		{
+			atomic_fetch_add(&skips[0], tile_skips);
+		}
+	});
+	a.synchronize();
+	skips.synchronize();
+
+	return total_skips;
+} // amp_mandelbrot_tiled
+
+// Generate mandelbrot set on GPU using amp with tiles
+void AmpMandelbrot::gpu_amp_mandelbrot_tiled(unsigned* counts, int width, int height, int stride, const Viewport& view)
+{
+	float left_, right_, top_, bottom_;
+	viewport_edges(view, left_, right_, top_, bottom_);
+
+	switch (tile_size)
+	{
+	case 8:
+		skipped_pixels = amp_mandelbrot_tiled<8>(counts, width, height, stride, max_iter, left_, right_, top_, bottom_);
+		break;
+	case 16:
+		skipped_pixels = amp_mandelbrot_tiled<16>(counts, width, height, stride, max_iter, left_, right_, top_, bottom_);
+		break;
+	case 32:
+		skipped_pixels = amp_mandelbrot_tiled<32>(counts, width, height, stride, max_iter, left_, right_, top_, bottom_);
+		break;
+	default:
+		skipped_pixels = amp_mandelbrot_tiled<4>(counts, width, height, stride, max_iter, left_, right_, top_, bottom_);
+		break;
+	}
+} // gpu_amp_mandelbrot_tiled
+
+long long AmpMandelbrot::skippedPixels() const
+{
+	return skipped_pixels;
+} // skippedPixels
@@ -0,0 +1,46 @@
+#pragma once
+
+// C++ AMP compute backend, no OpenGL/GLUT so the batch renderer can use it too.
+#include <amp.h>
+#include <stdint.h>
+#include "Viewport.h"
+
+// define the default tile size, setTileSize picks another at runtime
+// max threads 1024 per tile
+// max tiles 65536 in any dimension
+// 32 = MAX
+#define TS 4
+
+// AmpMandelbrot class
+// Runs the escape-time kernel on the default AMP accelerator.
+// Fills a width x height buffer of iteration counts, stride pixels per row, in the same
+// layout as CpuMandelbrot. Colouring is left to CpuMandelbrot::colour, on the CPU.
+// AMP errors (no accelerator, TDR...) are thrown to the caller as std::exception,
+// the caller decides how to report them.
+class AmpMandelbrot
+{
+public:
+	AmpMandelbrot();
+	~AmpMandelbrot();
+
+	// Set the values the next computation will use
+	void setMaxIterations(int max_iterations);
+	// Edge of the thread tiles used by gpu_amp_mandelbrot_tiled: 4, 8, 16 or 32
+	void setTileSize(int tile_size);
+	int tileSize() const;
+
+	// One thread per pixel. The kernels are float only (doubles are optional on DirectX 11 hardware),
+	// so views zoomed in past around 1e-4 break into blocks, use CpuMandelbrot for those.
+	void gpu_amp_mandelbrot(unsigned* counts, int width, int height, int stride, const Viewport& view);
+	// tile_size x tile_size thread tiles, the tiles along the right and bottom edges are padded
+	// with threads that only join the barriers
+	void gpu_amp_mandelbrot_tiled(unsigned* counts, int width, int height, int stride, const Viewport& view);
+
+	// Pixels the last computation skipped because they are inside the main cardioid or period-2 bulb
+	long long skippedPixels() const;
+
+protected:
+	unsigned max_iter;
+	int tile_size;
+	long long skipped_pixels;
+};
@@ -0,0 +1,649 @@
+#include "CpuMandelbrot.h"
+#include <cmath>
+#include <string.h>
+#include "MandelbrotKernel.h"
+#include "Palette.h"
+
+// Pixels batched per call into the point kernel, keeps the batch on the stack
+#define ROW_CHUNK 256
+
+CpuMandelbrot::CpuMandelbrot(unsigned thread_count) : pool(thread_count), scheduler(pool)
+{
+	tile_size = CPU_TS;
+	iterated_pixels = 0;
+	period_tolerance = 0.0f;
+	frame_period_tolerance = 0.0f;
+	precision_setting = PRECISION_AUTO;
+	series_approximation_on = true;
+	frame_precision = PRECISION_FLOAT;
+	frame_cancelled = false;
+	resetStats();
+	supported_simd_level = detect_simd_level();
+	simd_level = supported_simd_level;
+	max_iter = 500;
+	r = 1;
+	g = 1;
+	b = 1;
+}
+
+CpuMandelbrot::~CpuMandelbrot()
+{
+}
+
+// Set the maximum number of iterations before a point is assumed to be in the set
+void CpuMandelbrot::setMaxIterations(int max_iterations)
+{
+	max_iter = max_iterations;
+} // setMaxIterations
+
+// Set the colour multipliers colour() applies to the iteration counts
+void CpuMandelbrot::setColour(int red, int green, int blue)
+{
+	r = red;
+	g = green;
+	b = blue;
+} // setColour
+
+// Use a narrower kernel than the CPU supports (e.g. to compare against the scalar loop)
+void CpuMandelbrot::setSimdLevel(SimdLevel level)
+{
+	simd_level = level > supported_simd_level ? supported_simd_level : level;
+} // setSimdLevel
+
+void CpuMandelbrot::setTileSize(int size)
+{
+	tile_size = size < 1 ? 1 : size;
+} // setTileSize
+
+int CpuMandelbrot::tileSize() const
+{
+	return tile_size;
+} // tileSize
+
+// Turn Brent cycle detection on (tolerance above 0) or off (0)
+void CpuMandelbrot::setPeriodicityCheck(float tolerance)
+{
+	period_tolerance = tolerance > 0.0f ? tolerance : 0.0f;
+} // setPeriodicityCheck
+
+// Iterate in a fixed precision, or PRECISION_AUTO to choose one per frame from the pixel spacing
+void CpuMandelbrot::setPrecision(Precision precision)
+{
+	precision_setting = precision;
+} // setPrecision
+
+// Let perturbation frames start every pixel partway along the reference orbit
+void CpuMandelbrot::setSeriesApproximation(bool enabled)
+{
+	series_approximation_on = enabled;
+} // setSeriesApproximation
+
+// Let the caller abandon a frame part way through, e.g. when the view has moved on
+void CpuMandelbrot::setCancellation(const std::function<bool()>& cancel)
+{
+	cancel_check = cancel;
+} // setCancellation
+
+void scrolled_strips(int width, int height, int dx, int dy, Tile& rows, Tile& columns)
+{
+	int shift_x = dx < 0 ? -dx : dx;
+	int shift_y = dy < 0 ? -dy : dy;
+	if (shift_x >= width || shift_y >= height)
+	{
+		rows = { 0, 0, width, height };
+		columns = { 0, 0, 0, 0 };
+		return;
+	}
+	// Rows uncovered along the top or bottom, full width
+	rows = { 0, dy < 0 ? 0 : height - shift_y, width, shift_y };
+	// Columns uncovered along the left or right, between those rows
+	columns = { dx < 0 ? 0 : width - shift_x, dy < 0 ? shift_y : 0, shift_x, height - shift_y };
+} // scrolled_strips
+
+// Generate mandelbrot set on the CPU using the thread pool
+void CpuMandelbrot::cpu_mandelbrot(unsigned* counts, int width, int height, int stride, const Viewport& view)
+{
+	beginFrame(view, width, height);
+	pool.parallel_for(height, [=](int y)
+	{
+		if (stopRequested())
+		{
+			return;
+		}
+		computeSpan(counts + (size_t)y * stride, width, height, y, 0, width);
+	});
+} // cpu_mandelbrot
+
+// Generate mandelbrot set on the CPU using the work-stealing tile scheduler
+void CpuMandelbrot::cpu_mandelbrot_tiled(unsigned* counts, int width, int height, int stride, const Viewport& view)
+{
+	Tile whole_frame = { 0, 0, width, height };
+	cpu_mandelbrot_region(counts, stride, width, height, whole_frame, view);
+} // cpu_mandelbrot_tiled
+
+// Generate part of a frame using the work-stealing tile scheduler
+void CpuMandelbrot::cpu_mandelbrot_region(unsigned* counts, int stride, int width, int height, const Tile& region, const Viewport& view)
+{
+	beginFrame(view, width, height);
+	computeRegion(counts, stride, width, height, region);
+} // cpu_mandelbrot_region
+
+// Generate a list of rectangles of a frame on the thread pool, the shared index balances them
+void CpuMandelbrot::cpu_mandelbrot_tiles(unsigned* counts, int width, int height, int stride, const std::vector<Tile>& tiles, const Viewport& view)
+{
+	beginFrame(view, width, height);
+	iterated_pixels = 0;
+	pool.parallel_for((int)tiles.size(), [&](int i)
+	{
+		if (stopRequested())
+		{
+			return;
+		}
+		const Tile& t = tiles[i];
+		for (int y = t.y; y < t.y + t.height; y++)
+		{
+			computeCounts(counts, stride, width, height, y, t.x, t.width);
+		}
+		iterated_pixels += (long long)t.width * t.height;
+	});
+} // cpu_mandelbrot_tiles
+
+// Move what is still in view and compute the strips the pan uncovered
+void CpuMandelbrot::cpu_mandelbrot_scrolled(unsigned* counts, int width, int height, int stride, int dx, int dy, const Viewport& view)
+{
+	beginFrame(view, width, height);
+	int shift_x = dx < 0 ? -dx : dx;
+	int shift_y = dy < 0 ? -dy : dy;
+	Tile rows, columns;
+	scrolled_strips(width, height, dx, dy, rows, columns);
+
+	// Pixel (x, y) comes from (x + dx, y + dy), go through the rows in the order that doesn't
+	// overwrite a row before it has been moved
+	if (shift_x < width && shift_y < height)
+	{
+		int kept_width = width - shift_x;
+		int first_row = dy < 0 ? height - 1 : 0;
+		int row_step = dy < 0 ? -1 : 1;
+		for (int i = 0; i < height - shift_y; i++)
+		{
+			int y = first_row + i * row_step;
+			unsigned* row = counts + (size_t)y * stride;
+			unsigned* source = counts + (size_t)(y + dy) * stride;
+			memmove(row + (dx < 0 ? shift_x : 0), source + (dx < 0 ? 0 : dx), kept_width * sizeof(unsigned));
+		}
+	}
+
+	if (rows.height > 0)
+	{
+		computeRegion(counts + (size_t)rows.y * stride, stride, width, height, rows);
+	}
+	if (columns.width > 0)
+	{
+		computeRegion(counts + (size_t)columns.y * stride + columns.x, stride, width, height, columns);
+	}
+	iterated_pixels = (long long)rows.width * rows.height + (long long)columns.width * columns.height;
+} // cpu_mandelbrot_scrolled
+
+// Generate mandelbrot set on the CPU with Mariani-Silver subdivision, one tile per task
+void CpuMandelbrot::cpu_mandelbrot_mariani_silver(unsigned* counts, int width, int height, int stride, const Viewport& view)
+{
+	iterated_pixels = 0;
+	beginFrame(view, width, height);
+
+	scheduler.run(width, height, MARIANI_TS, [&](const Tile& t)
+	{
+		if (stopRequested())
+		{
+			return;
+		}
+		// Iterate the tile's own border, tiles don't share pixels so no other task touches these
+		std::vector<Tile> pending;
+		pending.push_back({ t.x, t.y, t.width, 1 });
+		if (t.height > 1)
+		{
+			pending.push_back({ t.x, t.y + t.height - 1, t.width, 1 });
+		}
+		if (t.height > 2)
+		{
+			pending.push_back({ t.x, t.y + 1, 1, t.height - 2 });
+			if (t.width > 1)
+			{
+				pending.push_back({ t.x + t.width - 1, t.y + 1, 1, t.height - 2 });
+			}
+		}
+		long long iterated = computeRects(counts, stride, width, height, pending);
+
+		// Then a level of the subdivision at a time. Every rectangle of the level is filled or
+		// split, and the pixels that leaves to iterate all go through the kernel in one batch:
+		// a single line is too short to keep the vector lanes busy.
+		std::vector<Tile> level(1, t);
+		std::vector<Tile> halves;
+		while (!level.empty())
+		{
+			pending.clear();
+			halves.clear();
+			for (size_t i = 0; i < level.size(); i++)
+			{
+				subdivide(counts, stride, level[i], pending, halves);
+			}
+			iterated += computeRects(counts, stride, width, height, pending);
+			level.swap(halves);
+		}
+
+		iterated_pixels += iterated;
+	});
+} // cpu_mandelbrot_mariani_silver
+
+// Compute the new samples of a progressive pass a sample row per task, then spread each sample
+// over its block
+void CpuMandelbrot::cpu_mandelbrot_progressive(unsigned* counts, int width, int height, int stride, int step, int previous_step, const Viewport& view)
+{
+	beginFrame(view, width, height);
+	step = step < 1 ? 1 : step;
+	previous_step = previous_step == 2 * step ? previous_step : 0;
+	int sample_rows = (height + step - 1) / step;
+	iterated_pixels = 0;
+
+	pool.parallel_for(sample_rows, [=](int j)
+	{
+		if (stopRequested())
+		{
+			return;
+		}
+		int y = j * step;
+		unsigned* row = counts + (size_t)y * stride;
+		// Rows the last pass sampled already have every other sample of this one
+		if (previous_step > 0 && y % previous_step == 0)
+		{
+			iterated_pixels += computeSamples(row, width, height, y, step, previous_step);
+		}
+		else
+		{
+			iterated_pixels += computeSamples(row, width, height, y, 0, step);
+		}
+	});
+
+	if (step == 1 || frame_cancelled)
+	{
+		return;
+	}
+	// Spread each sample over its block, leaving the sample itself for the next pass to keep
+	pool.parallel_for(sample_rows, [=](int j)
+	{
+		int y = j * step;
+		const unsigned* sample_row = counts + (size_t)y * stride;
+		int block_h = height - y < step ? height - y : step;
+		for (int k = 0; k < block_h; k++)
+		{
+			unsigned* row = counts + (size_t)(y + k) * stride;
+			for (int x = 0; x < width; x += step)
+			{
+				unsigned value = sample_row[x];
+				int end = x + step < width ? x + step : width;
+				for (int i = k == 0 ? x + 1 : x; i < end; i++)
+				{
+					row[i] = value;
+				}
+			}
+		}
+	});
+} // cpu_mandelbrot_progressive
+
+// Colour the counts through the palette a row per task, image may be the counts buffer itself
+void CpuMandelbrot::colour(const unsigned* counts, int count_stride, uint32_t* image, int stride, int width, int height)
+{
+	palette.build(max_iter, r, g, b);
+	pool.parallel_for(height, [=](int y)
+	{
+		palette_row(simd_level, palette, counts + (size_t)y * count_stride, image + (size_t)y * stride, width);
+	});
+} // colour
+
+bool CpuMandelbrot::cancelled() const
+{
+	return frame_cancelled;
+} // cancelled
+
+long long CpuMandelbrot::iteratedPixels() const
+{
+	return iterated_pixels;
+} // iteratedPixels
+
+long long CpuMandelbrot::skippedPixels() const
+{
+	return skipped_pixels;
+} // skippedPixels
+
+long long CpuMandelbrot::periodicPixels() const
+{
+	return periodic_pixels;
+} // periodicPixels
+
+long long CpuMandelbrot::iterationsSaved() const
+{
+	return iterations_saved;
+} // iterationsSaved
+
+long long CpuMandelbrot::rebasedCount() const
+{
+	return rebased_count;
+} // rebasedCount
+
+unsigned CpuMandelbrot::threadCount() const
+{
+	return pool.size();
+} // threadCount
+
+SimdLevel CpuMandelbrot::simdLevel() const
+{
+	return simd_level;
+} // simdLevel
+
+Precision CpuMandelbrot::precision() const
+{
+	return frame_precision;
+} // precision
+
+// The precision setting, with PRECISION_AUTO resolved for the view
+Precision CpuMandelbrot::precisionFor(const Viewport& view, int width, int height) const
+{
+	return precision_setting == PRECISION_AUTO ? required_precision(view, width, height) : precision_setting;
+} // precisionFor
+
+bool CpuMandelbrot::seriesApproximation() const
+{
+	return series_approximation_on;
+} // seriesApproximation
+
+TileScheduler& CpuMandelbrot::tileScheduler()
+{
+	return scheduler;
+} // tileScheduler
+
+const ReferenceOrbit& CpuMandelbrot::referenceOrbit() const
+{
+	return reference_orbit;
+} // referenceOrbit
+
+unsigned CpuMandelbrot::seriesSkip() const
+{
+	return frame_series.skip;
+} // seriesSkip
+
+// Compute part of one row of the mandelbrot set
+void CpuMandelbrot::computeSpan(unsigned* row, int width, int height, int y, int x, int count)
+{
+	KernelStats stats = {};
+	iterateRow(row, width, height, y, x, count, stats);
+	addStats(stats);
+} // computeSpan
+
+// Compute iteration counts for part of one row, used where only some pixels are wanted
+void CpuMandelbrot::computeCounts(unsigned* counts, int stride, int width, int height, int y, int x, int count)
+{
+	computeSpan(counts + (size_t)y * stride + x, width, height, y, x, count);
+} // computeCounts
+
+// Run the row kernel for the precision the frame needs
+void CpuMandelbrot::iterateRow(unsigned* counts, int width, int height, int y, int x0, int count, KernelStats& stats)
+{
+	if (frame_precision == PRECISION_FLOAT)
+	{
+		unsigned w = width;
+		unsigned h = height;
+
+		// Work out the imaginary part shared by every pixel in this row,
+		// the row kernel works out the real part per pixel.
+		float cy = view_top + (y * (view_bottom - view_top) / h);
+		escape_time_row(simd_level, counts, x0, count, view_left, view_right - view_left, w, cy, max_iter, frame_period_tolerance, stats);
+	}
+	else if (frame_precision == PRECISION_PERTURBATION)
+	{
+		escape_time_row_perturbed(reference_orbit, frame_series, counts, x0, count, y, width, height, frame_view, max_iter, stats);
+	}
+	else
+	{
+		escape_time_row_precise(frame_precision, counts, x0, count, y, width, height, frame_view, max_iter, frame_period_tolerance, stats);
+	}
+} // iterateRow
+
+// Gather the points of every rectangle into one batch for the point kernel
+long long CpuMandelbrot::computeRects(unsigned* counts, int stride, int width, int height, const std::vector<Tile>& rects)
+{
+	long long pixels = 0;
+	for (size_t r = 0; r < rects.size(); r++)
+	{
+		pixels += (long long)rects[r].width * rects[r].height;
+	}
+
+	// The precise kernels are scalar anyway, so there is nothing to gain from batching
+	if (frame_precision != PRECISION_FLOAT)
+	{
+		for (size_t r = 0; r < rects.size(); r++)
+		{
+			const Tile& rect = rects[r];
+			for (int j = rect.y; j < rect.y + rect.height; j++)
+			{
+				computeCounts(counts, stride, width, height, j, rect.x, rect.width);
+			}
+		}
+		return pixels;
+	}
+
+	unsigned w = width;
+	unsigned h = height;
+
+	std::vector<float> cxs((size_t)pixels);
+	std::vector<float> cys((size_t)pixels);
+	std::vector<size_t> offsets((size_t)pixels);
+	size_t k = 0;
+	for (size_t r = 0; r < rects.size(); r++)
+	{
+		const Tile& rect = rects[r];
+		for (int j = rect.y; j < rect.y + rect.height; j++)
+		{
+			float cy = view_top + (j * (view_bottom - view_top) / h);
+			for (int i = rect.x; i < rect.x + rect.width; i++, k++)
+			{
+				cxs[k] = view_left + (i * (view_right - view_left) / w);
+				cys[k] = cy;
+				offsets[k] = (size_t)j * stride + i;
+			}
+		}
+	}
+
+	std::vector<unsigned> results((size_t)pixels);
+	KernelStats stats = {};
+	escape_time_points_streamed(simd_level, results.data(), cxs.data(), cys.data(), (int)pixels, max_iter, frame_period_tolerance, stats);
+	for (k = 0; k < results.size(); k++)
+	{
+		counts[offsets[k]] = results[k];
+	}
+	addStats(stats);
+	return pixels;
+} // computeRects
+
+// Batch every x_step-th pixel of a row into the point kernel
+int CpuMandelbrot::computeSamples(unsigned* row, int width, int height, int y, int x0, int x_step)
+{
+	KernelStats stats = {};
+	int computed = 0;
+	// The precise kernels are scalar anyway, so each pixel is a row of one
+	if (frame_precision != PRECISION_FLOAT)
+	{
+		for (int x = x0; x < width; x += x_step)
+		{
+			iterateRow(row + x, width, height, y, x, 1, stats);
+			computed++;
+		}
+		addStats(stats);
+		return computed;
+	}
+
+	unsigned w = width;
+	unsigned h = height;
+
+	float cxs[ROW_CHUNK];
+	float cys[ROW_CHUNK];
+	unsigned results[ROW_CHUNK];
+	float cy = view_top + (y * (view_bottom - view_top) / h);
+	for (int i = 0; i < ROW_CHUNK; i++)
+	{
+		cys[i] = cy;
+	}
+
+	for (int x = x0; x < width; )
+	{
+		int batched = 0;
+		int first = x;
+		for (; x < width && batched < ROW_CHUNK; x += x_step)
+		{
+			cxs[batched++] = view_left + (x * (view_right - view_left) / w);
+		}
+		escape_time_points(simd_level, results, cxs, cys, batched, max_iter, frame_period_tolerance, stats);
+		for (int k = 0; k < batched; k++)
+		{
+			row[first + k * x_step] = results[k];
+		}
+		computed += batched;
+	}
+	addStats(stats);
+	return computed;
+} // computeSamples
+
+// Run the region's tiles on the scheduler, counts holds the region's top-left pixel
+void CpuMandelbrot::computeRegion(unsigned* counts, int stride, int width, int height, const Tile& region)
+{
+	scheduler.run(region.width, region.height, tile_size, [&](const Tile& t)
+	{
+		if (stopRequested())
+		{
+			return;
+		}
+		for (int y = t.y; y < t.y + t.height; y++)
+		{
+			computeSpan(counts + (size_t)y * stride + t.x, width, height, region.y + y, region.x + t.x, t.width);
+		}
+	});
+} // computeRegion
+
+// Work out everything the kernels need from the viewport before a new frame
+void CpuMandelbrot::beginFrame(const Viewport& view, int width, int height)
+{
+	frame_view = view;
+	viewport_edges(view, view_left, view_right, view_top, view_bottom);
+	frame_precision = precisionFor(view, width, height);
+	// Scaled with the view, a tolerance near the pixel spacing ends escaping orbits early
+	frame_period_tolerance = (float)std::fmin(period_tolerance, viewport_pixel_spacing(view, width, height) * PERIOD_SPACING_FRACTION);
+	// Every row is perturbed against the same orbit, iterate it once up front
+	if (frame_precision == PRECISION_PERTURBATION)
+	{
+		reference_orbit.compute(view.x, view.y, max_iter);
+	}
+	frame_series = SeriesApproximation();
+	if (frame_precision == PRECISION_PERTURBATION && series_approximation_on)
+	{
+		frame_series = series_approximation(reference_orbit, view, max_iter);
+	}
+	frame_cancelled = false;
+	resetStats();
+} // beginFrame
+
+// Add one call's kernel statistics to the frame totals
+void CpuMandelbrot::addStats(const KernelStats& stats)
+{
+	skipped_pixels += stats.skipped;
+	periodic_pixels += stats.periodic;
+	iterations_saved += stats.iterations_saved;
+	rebased_count += stats.rebased;
+} // addStats
+
+// Zero the frame totals before a new frame
+void CpuMandelbrot::resetStats()
+{
+	skipped_pixels = 0;
+	periodic_pixels = 0;
+	iterations_saved = 0;
+	rebased_count = 0;
+} // resetStats
+
+// Once one thread has seen the check say yes, the others stop without calling it
+bool CpuMandelbrot::stopRequested()
+{
+	if (frame_cancelled)
+	{
+		return true;
+	}
+	if (cancel_check && cancel_check())
+	{
+		frame_cancelled = true;
+		return true;
+	}
+	return false;
+} // stopRequested
+
+// Fill the rectangle if its border is a single iteration count, otherwise queue the pixels that
+// need iterating and the halves to check once they have been
+void CpuMandelbrot::subdivide(unsigned* counts, int stride, const Tile& rect, std::vector<Tile>& pending, std::vector<Tile>& halves)
+{
+	int x = rect.x;
+	int y = rect.y;
+	int rect_w = rect.width;
+	int rect_h = rect.height;
+	// Nothing inside the border
+	if (rect_w <= 2 || rect_h <= 2)
+	{
+		return;
+	}
+
+	// Check whether every border pixel has the same count
+	const unsigned* top_row = counts + (size_t)y * stride;
+	const unsigned* bottom_row = counts + (size_t)(y + rect_h - 1) * stride;
+	unsigned value = top_row[x];
+	bool uniform = true;
+	for (int i = x; i < x + rect_w && uniform; i++)
+	{
+		uniform = top_row[i] == value && bottom_row[i] == value;
+	}
+	for (int j = y + 1; j < y + rect_h - 1 && uniform; j++)
+	{
+		const unsigned* row = counts + (size_t)j * stride;
+		uniform = row[x] == value && row[x + rect_w - 1] == value;
+	}
+
+	if (uniform)
+	{
+		for (int j = y + 1; j < y + rect_h - 1; j++)
+		{
+			unsigned* row = counts + (size_t)j * stride;
+			for (int i = x + 1; i < x + rect_w - 1; i++)
+			{
+				row[i] = value;
+			}
+		}
+		return;
+	}
+
+	// Too small to be worth splitting, just iterate the inside
+	if (rect_w <= MARIANI_MIN_SIZE || rect_h <= MARIANI_MIN_SIZE)
+	{
+		pending.push_back({ x + 1, y + 1, rect_w - 2, rect_h - 2 });
+		return;
+	}
+
+	// Split across the longer side, the dividing line becomes a border of both halves
+	if (rect_w >= rect_h)
+	{
+		int mid = x + rect_w / 2;
+		pending.push_back({ mid, y + 1, 1, rect_h - 2 });
+		halves.push_back({ x, y, mid - x + 1, rect_h });
+		halves.push_back({ mid, y, x + rect_w - mid, rect_h });
+	}
+	else
+	{
+		int mid = y + rect_h / 2;
+		pending.push_back({ x + 1, mid, rect_w - 2, 1 });
+		halves.push_back({ x, y, rect_w, mid - y + 1 });
+		halves.push_back({ x, mid, rect_w, y + rect_h - mid });
+	}
+} // subdivide
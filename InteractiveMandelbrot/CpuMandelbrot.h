@@ -0,0 +1,215 @@
+#pragma once
+
+// CPU compute backend, standard library only so it builds on machines without a GPU.
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+#include "ThreadPool.h"
+#include "Palette.h"
+#include "Perturbation.h"
+#include "PrecisionKernel.h"
+#include "SimdKernel.h"
+#include "TileScheduler.h"
+#include "Viewport.h"
+
+// Default tile edge for the work-stealing scheduler.
+// The AMP TS tiles (4-32) are sized for GPU thread groups, on the CPU a tile
+// this wide keeps the AVX lanes full while still giving plenty of tiles to steal.
+#define CPU_TS 32
+
+// Tile edge for the Mariani-Silver mode, bigger tiles give the subdivision more
+// solid area to fill in one go
+#define MARIANI_TS 128
+// Rectangles this thin or smaller are brute forced rather than subdivided further
+#define MARIANI_MIN_SIZE 6
+
+// Cycle detection tolerance is capped at this fraction of a frame's pixel spacing. Orbits of
+// neighbouring pixels are about a pixel apart, so a tolerance near the spacing catches escaping
+// points in deep views as if they had cycled.
+#define PERIOD_SPACING_FRACTION 0.01
+
+// The strips a pan of whole pixels uncovers in a width x height frame (cpu_mandelbrot_scrolled):
+// rows along the top or bottom, full width, and columns along the left or right between them.
+// Either may be empty. rows is the whole frame when the pan moves all of it out of view.
+void scrolled_strips(int width, int height, int dx, int dy, Tile& rows, Tile& columns);
+
+// CpuMandelbrot class
+// Computes the same iteration counts as the AMP kernels, using every core of the CPU.
+// Takes the same viewport as the AMP kernels and fills a width x height buffer of counts laid
+// out exactly like the one the AMP array_view writes to, stride pixels per row. colour() turns
+// counts into the image, so a new palette doesn't need the set computing again.
+// Views zoomed in past what float can resolve are iterated in double, double-double or
+// by perturbing a reference orbit.
+class CpuMandelbrot
+{
+public:
+	// thread_count of 0 uses one thread per hardware thread
+	CpuMandelbrot(unsigned thread_count = 0);
+	~CpuMandelbrot();
+
+	// Set the values the next computation will use
+	void setMaxIterations(int max_iterations);
+	// Colour multipliers colour() applies, they have no effect on the counts
+	void setColour(int red, int green, int blue);
+	// Choose the vector kernel, capped at what the CPU supports
+	void setSimdLevel(SimdLevel level);
+	// Tile edge used by cpu_mandelbrot_tiled
+	void setTileSize(int tile_size);
+	int tileSize() const;
+	// Stop iterating points whose orbit comes back within tolerance of an earlier point.
+	// 0 turns the check off. Saves time on pixels inside the set, but a tolerance that's too
+	// large can mark slowly escaping points near the boundary as inside. Each frame uses at most
+	// PERIOD_SPACING_FRACTION of its pixel spacing, so a tolerance picked at zoom 1 is safe deeper in.
+	void setPeriodicityCheck(float tolerance);
+	// Number type to iterate with, PRECISION_AUTO (the default) picks the cheapest one
+	// that resolves each frame. Only PRECISION_FLOAT uses the SIMD kernels, and only it and
+	// the double and double-double kernels use the cardioid/bulb test and cycle detection.
+	void setPrecision(Precision precision);
+	// Series approximation for perturbation frames (on by default): every pixel starts as many
+	// iterations in as the series stays accurate for, instead of at z = 0
+	void setSeriesApproximation(bool enabled);
+	// Check to stop a frame early, called before each row or tile is started (from any thread) and
+	// until it first returns true. The rest of the frame is then skipped, its counts are incomplete.
+	// An empty function (the default) never stops.
+	void setCancellation(const std::function<bool()>& cancel);
+
+	// Generate mandelbrot set on the CPU, rows are spread across the thread pool
+	void cpu_mandelbrot(unsigned* counts, int width, int height, int stride, const Viewport& view);
+
+	// Generate mandelbrot set on the CPU in small tiles, idle workers steal tiles from busy ones
+	void cpu_mandelbrot_tiled(unsigned* counts, int width, int height, int stride, const Viewport& view);
+
+	// Generate only the region of a width x height frame, with the same tiles as cpu_mandelbrot_tiled.
+	// counts holds just the region, its top-left pixel first and stride pixels per row, so a frame too
+	// big for memory can be computed a band at a time. Pixels map to the plane exactly as they
+	// would if the whole frame were computed at once.
+	void cpu_mandelbrot_region(unsigned* counts, int stride, int width, int height, const Tile& region, const Viewport& view);
+
+	// Generate only the listed rectangles of a width x height frame, a rectangle per task, e.g. the
+	// tiles a cache didn't have. The rest of counts is left as it is.
+	void cpu_mandelbrot_tiles(unsigned* counts, int width, int height, int stride, const std::vector<Tile>& tiles, const Viewport& view);
+
+	// Update a frame after a pan of whole pixels. counts holds the frame computed for the view dx, dy
+	// pixels away from this one (dx > 0 when the view moved right, dy > 0 when it moved down the
+	// image): the pixels still in view are moved, pixel (x, y) taking the one at (x + dx, y + dy),
+	// and only the strips uncovered along the edges are computed, with the same tiles as
+	// cpu_mandelbrot_tiled. Every pixel is mapped from the new view, so the moved ones were worked out
+	// from a different origin than a full render would use. In float that rounding moves a few
+	// points across a band edge: 0.2-3% of the pixels get a different count, more the further in
+	// the view is zoomed. In double it is a handful of pixels per frame.
+	void cpu_mandelbrot_scrolled(unsigned* counts, int width, int height, int stride, int dx, int dy, const Viewport& view);
+
+	// Generate mandelbrot set with Mariani-Silver rectangle subdivision.
+	// Only the border of each rectangle is iterated, rectangles with a uniform border are filled,
+	// the rest are split in two and checked again. Every pixel that is iterated gets the same count
+	// as cpu_mandelbrot gives it, so the counts match except where a filament thinner than a
+	// pixel passes through a rectangle without touching any of its border pixels.
+	void cpu_mandelbrot_mariani_silver(unsigned* counts, int width, int height, int stride, const Viewport& view);
+
+	// One pass of progressive refinement. Computes the pixels whose x and y are both multiples of
+	// step and fills the step x step block below and to the right of each with its count, so a
+	// coarse pass is a blocky preview of the frame at 1/step resolution. previous_step is the
+	// step of the pass already in counts for the same view (2 x step), whose samples are kept
+	// rather than computed again, or 0 to compute every sample. A pass with step 1 leaves exactly
+	// the counts cpu_mandelbrot would.
+	void cpu_mandelbrot_progressive(unsigned* counts, int width, int height, int stride, int step, int previous_step, const Viewport& view);
+
+	// Colour a width x height frame of iteration counts into image with the colour and maximum
+	// iterations set now, a row per task, through a lookup table with the vector kernel's
+	// instruction set. image may be counts itself (and count_stride stride) to colour in place.
+	void colour(const unsigned* counts, int count_stride, uint32_t* image, int stride, int width, int height);
+	// Whether the last frame was stopped by the cancellation check
+	bool cancelled() const;
+	// Pixels the last Mariani-Silver, scrolled or progressive frame actually ran the escape-time loop for
+	long long iteratedPixels() const;
+	// Pixels the last frame (any mode) skipped because they are inside the main cardioid or period-2 bulb
+	long long skippedPixels() const;
+	// Pixels the last frame stopped early with cycle detection, and the iterations that saved
+	long long periodicPixels() const;
+	long long iterationsSaved() const;
+	// Times a perturbed pixel in the last frame was rebased onto the start of the reference orbit
+	long long rebasedCount() const;
+
+	// Number of threads the backend computes with
+	unsigned threadCount() const;
+	// Vector kernel the backend computes with
+	SimdLevel simdLevel() const;
+	// Precision the last frame was iterated in
+	Precision precision() const;
+	// Precision a width x height frame of view would be iterated in with the current setting
+	Precision precisionFor(const Viewport& view, int width, int height) const;
+	// Whether perturbation frames use the series approximation
+	bool seriesApproximation() const;
+	// Scheduler used by cpu_mandelbrot_tiled, holds the per-tile timings of the last frame
+	TileScheduler& tileScheduler();
+	// Orbit of the view centre the last perturbation frame was computed against
+	const ReferenceOrbit& referenceOrbit() const;
+	// Iterations every pixel of the last perturbation frame skipped with the series approximation
+	unsigned seriesSkip() const;
+
+protected:
+	// Compute every pixel of region on the tile scheduler, counts holds the region's top-left pixel
+	void computeRegion(unsigned* counts, int stride, int width, int height, const Tile& region);
+	// Compute count pixels of row y starting at x0, into row[0] onwards
+	void computeSpan(unsigned* row, int width, int height, int y, int x0, int count);
+	// Compute count pixels of row y starting at x0, into their place in a frame of counts
+	void computeCounts(unsigned* counts, int stride, int width, int height, int y, int x0, int count);
+	// Compute the iteration counts of every pixel in a list of rectangles with one call into
+	// escape_time_points_streamed, so columns and small blocks are vectorised too and a lane can
+	// move on from a slow pixel to the next one of any rectangle. Returns the number of pixels computed.
+	long long computeRects(unsigned* counts, int stride, int width, int height, const std::vector<Tile>& rects);
+	// Compute the pixels x0, x0 + x_step, x0 + 2 x_step ... of row y into their place in row[],
+	// batched through the point kernel like computeRects. Returns the number computed.
+	int computeSamples(unsigned* row, int width, int height, int y, int x0, int x_step);
+	// Compute the iteration counts of count pixels of row y starting at x0, into counts[0] onwards,
+	// with the kernel for the frame's precision
+	void iterateRow(unsigned* counts, int width, int height, int y, int x0, int count, KernelStats& stats);
+	// Store the viewport and choose the precision for a new frame, and zero the statistics
+	void beginFrame(const Viewport& view, int width, int height);
+	// Add a kernel call's statistics to the frame totals, and zero them for a new frame
+	void addStats(const KernelStats& stats);
+	void resetStats();
+	// Whether the frame should stop, asks the cancellation check until it says yes
+	bool stopRequested();
+	// Fill or split the rectangle whose border counts are already known. Adds the pixels that need
+	// iterating before the next level to pending, and the rectangles that level checks to halves.
+	void subdivide(unsigned* counts, int stride, const Tile& rect, std::vector<Tile>& pending, std::vector<Tile>& halves);
+
+	ThreadPool pool;
+	TileScheduler scheduler;
+	int tile_size;
+
+	std::atomic<long long> iterated_pixels;
+	std::atomic<long long> skipped_pixels;
+	std::atomic<long long> periodic_pixels;
+	std::atomic<long long> iterations_saved;
+	std::atomic<long long> rebased_count;
+
+	// Widest kernel the CPU supports, and the one currently in use
+	SimdLevel supported_simd_level;
+	SimdLevel simd_level;
+
+	unsigned max_iter;
+	unsigned r, g, b;
+	// Tolerance asked for with setPeriodicityCheck, and the one the current frame uses
+	float period_tolerance;
+	float frame_period_tolerance;
+	// Lookup table for colour, rebuilt when max_iter or the colour changes
+	Palette palette;
+
+	// Precision asked for with setPrecision, and the one the current frame uses
+	Precision precision_setting;
+	Precision frame_precision;
+	// Viewport of the current frame, and its edges as floats for the SIMD kernels
+	Viewport frame_view;
+	float view_left, view_right, view_top, view_bottom;
+	// Orbit of the view centre for PRECISION_PERTURBATION frames, and the series that lets
+	// pixels start partway along it
+	ReferenceOrbit reference_orbit;
+	SeriesApproximation frame_series;
+	bool series_approximation_on;
+
+	std::function<bool()> cancel_check;
+	std::atomic<bool> frame_cancelled;
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+// Double-double arithmetic: a value is held as the unevaluated sum hi + lo of two doubles,
+// giving about 106 bits of mantissa (~32 decimal digits) using only double operations.
+// Built on Dekker's and Knuth's error-free transformations, which need every operation
+// rounded to double on its own. Don't let the compiler fuse a*b + c into an FMA where these
+// are used (GCC: -ffp-contract=off, which -std=c++14 already implies; MSVC: the default /fp:precise).
+
+// Splits a double into two halves of 26 bits
+#define DD_SPLITTER 134217729.0 // 2^27 + 1
+
+struct DoubleDouble
+{
+	double hi;
+	double lo;
+
+	DoubleDouble() : hi(0.0), lo(0.0) {}
+	DoubleDouble(double value) : hi(value), lo(0.0) {}
+	DoubleDouble(double high, double low) : hi(high), lo(low) {}
+};
+
+// s + err == a + b exactly, for any a and b
+inline DoubleDouble dd_two_sum(double a, double b)
+{
+	double s = a + b;
+	double bb = s - a;
+	double err = (a - (s - bb)) + (b - bb);
+	return DoubleDouble(s, err);
+} // dd_two_sum
+
+// s + err == a + b exactly, only when |a| >= |b|
+inline DoubleDouble dd_quick_two_sum(double a, double b)
+{
+	double s = a + b;
+	double err = b - (s - a);
+	return DoubleDouble(s, err);
+} // dd_quick_two_sum
+
+// p + err == a * b exactly
+inline DoubleDouble dd_two_prod(double a, double b)
+{
+	double p = a * b;
+	double t = DD_SPLITTER * a;
+	double a_hi = t - (t - a);
+	double a_lo = a - a_hi;
+	t = DD_SPLITTER * b;
+	double b_hi = t - (t - b);
+	double b_lo = b - b_hi;
+	double err = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+	return DoubleDouble(p, err);
+} // dd_two_prod
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b)
+{
+	DoubleDouble s = dd_two_sum(a.hi, b.hi);
+	DoubleDouble t = dd_two_sum(a.lo, b.lo);
+	s.lo += t.hi;
+	s = dd_quick_two_sum(s.hi, s.lo);
+	s.lo += t.lo;
+	return dd_quick_two_sum(s.hi, s.lo);
+} // operator+
+
+inline DoubleDouble operator-(const DoubleDouble& a)
+{
+	return DoubleDouble(-a.hi, -a.lo);
+} // operator-
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return a + (-b);
+} // operator-
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b)
+{
+	DoubleDouble p = dd_two_prod(a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return dd_quick_two_sum(p.hi, p.lo);
+} // operator*
+
+inline DoubleDouble operator/(const DoubleDouble& a, double b)
+{
+	// One correction step of the long division q = a / b
+	double q1 = a.hi / b;
+	DoubleDouble r = a - dd_two_prod(q1, b);
+	double q2 = r.hi / b;
+	return dd_quick_two_sum(q1, q2);
+} // operator/
+
+inline DoubleDouble& operator+=(DoubleDouble& a, const DoubleDouble& b)
+{
+	a = a + b;
+	return a;
+} // operator+=
+
+inline DoubleDouble& operator-=(DoubleDouble& a, const DoubleDouble& b)
+{
+	a = a - b;
+	return a;
+} // operator-=
+
+inline bool operator<(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+} // operator<
+
+inline bool operator>(const DoubleDouble& a, const DoubleDouble& b)
+{
+	return b < a;
+} // operator>
+
+// Nearest double, for printing and for the lower precision kernels
+inline double to_double(const DoubleDouble& a)
+{
+	return a.hi + a.lo;
+} // to_double
+
+inline double to_double(double a)
+{
+	return a;
+} // to_double
+
+inline double to_double(float a)
+{
+	return a;
+} // to_double
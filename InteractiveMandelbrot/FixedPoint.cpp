@@ -0,0 +1,294 @@
+#include "FixedPoint.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// Is every limb zero
+static bool is_zero(const FixedPoint& a)
+{
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		if (a.limbs[i] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+} // is_zero
+
+FixedPoint::FixedPoint()
+{
+	negative = false;
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		limbs[i] = 0;
+	}
+}
+
+FixedPoint::FixedPoint(double value)
+{
+	negative = value < 0.0;
+	double remaining = std::fabs(value);
+	// Peel the bits off a limb at a time from the top, every step is exact
+	for (int i = FIXED_LIMBS - 1; i >= 0; i--)
+	{
+		double unit = std::ldexp(1.0, 32 * i - FIXED_FRACTION_BITS);
+		double limb = std::floor(remaining / unit);
+		limbs[i] = (uint32_t)limb;
+		remaining -= limb * unit;
+	}
+	// Anything below the last bit rounds to zero, which has no sign
+	if (is_zero(*this))
+	{
+		negative = false;
+	}
+}
+
+FixedPoint::FixedPoint(const DoubleDouble& value)
+{
+	*this = FixedPoint(value.hi) + FixedPoint(value.lo);
+}
+
+// -1, 0 or 1 as |a| is less than, equal to or greater than |b|
+static int compare_magnitude(const FixedPoint& a, const FixedPoint& b)
+{
+	for (int i = FIXED_LIMBS - 1; i >= 0; i--)
+	{
+		if (a.limbs[i] != b.limbs[i])
+		{
+			return a.limbs[i] < b.limbs[i] ? -1 : 1;
+		}
+	}
+	return 0;
+} // compare_magnitude
+
+// |a| + |b|, anything carried out of the integer limb is lost
+static void add_magnitude(const FixedPoint& a, const FixedPoint& b, FixedPoint& result)
+{
+	uint64_t carry = 0;
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		uint64_t sum = (uint64_t)a.limbs[i] + b.limbs[i] + carry;
+		result.limbs[i] = (uint32_t)sum;
+		carry = sum >> 32;
+	}
+} // add_magnitude
+
+// |a| - |b|, only when |a| >= |b|
+static void subtract_magnitude(const FixedPoint& a, const FixedPoint& b, FixedPoint& result)
+{
+	uint64_t borrow = 0;
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		uint64_t difference = (uint64_t)a.limbs[i] - b.limbs[i] - borrow;
+		result.limbs[i] = (uint32_t)difference;
+		borrow = (difference >> 32) & 1;
+	}
+} // subtract_magnitude
+
+FixedPoint operator+(const FixedPoint& a, const FixedPoint& b)
+{
+	FixedPoint result;
+	if (a.negative == b.negative)
+	{
+		add_magnitude(a, b, result);
+		result.negative = a.negative;
+	}
+	else if (compare_magnitude(a, b) >= 0)
+	{
+		subtract_magnitude(a, b, result);
+		result.negative = a.negative;
+	}
+	else
+	{
+		subtract_magnitude(b, a, result);
+		result.negative = b.negative;
+	}
+	// Keep a single zero so == works
+	if (is_zero(result))
+	{
+		result.negative = false;
+	}
+	return result;
+} // operator+
+
+FixedPoint operator-(const FixedPoint& a)
+{
+	FixedPoint result = a;
+	result.negative = !a.negative && !is_zero(a);
+	return result;
+} // operator-
+
+FixedPoint operator-(const FixedPoint& a, const FixedPoint& b)
+{
+	return a + (-b);
+} // operator-
+
+FixedPoint operator*(const FixedPoint& a, const FixedPoint& b)
+{
+	// Schoolbook product of the magnitudes, twice as many limbs and twice as many fraction bits
+	uint32_t product[2 * FIXED_LIMBS] = {};
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		if (a.limbs[i] == 0)
+		{
+			continue;
+		}
+		uint64_t carry = 0;
+		for (int j = 0; j < FIXED_LIMBS; j++)
+		{
+			uint64_t t = (uint64_t)a.limbs[i] * b.limbs[j] + product[i + j] + carry;
+			product[i + j] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		product[i + FIXED_LIMBS] = (uint32_t)carry;
+	}
+
+	// Drop the extra fraction limbs
+	FixedPoint result;
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		result.limbs[i] = product[i + FIXED_LIMBS - 1];
+	}
+	result.negative = a.negative != b.negative && !is_zero(result);
+	return result;
+} // operator*
+
+FixedPoint& operator+=(FixedPoint& a, const FixedPoint& b)
+{
+	a = a + b;
+	return a;
+} // operator+=
+
+FixedPoint& operator-=(FixedPoint& a, const FixedPoint& b)
+{
+	a = a - b;
+	return a;
+} // operator-=
+
+bool operator==(const FixedPoint& a, const FixedPoint& b)
+{
+	return a.negative == b.negative && compare_magnitude(a, b) == 0;
+} // operator==
+
+bool operator!=(const FixedPoint& a, const FixedPoint& b)
+{
+	return !(a == b);
+} // operator!=
+
+double to_double(const FixedPoint& a)
+{
+	// Smallest limbs first so the rounding happens once the big ones are added
+	double result = 0.0;
+	for (int i = 0; i < FIXED_LIMBS; i++)
+	{
+		result += std::ldexp((double)a.limbs[i], 32 * i - FIXED_FRACTION_BITS);
+	}
+	return a.negative ? -result : result;
+} // to_double
+
+DoubleDouble to_double_double(const FixedPoint& a)
+{
+	double hi = to_double(a);
+	double lo = to_double(a - FixedPoint(hi));
+	return dd_quick_two_sum(hi, lo);
+} // to_double_double
+
+// Long division of the magnitude by 10, a limb at a time from the top
+static void divide_by_ten(FixedPoint& a)
+{
+	uint64_t remainder = 0;
+	for (int i = FIXED_LIMBS - 1; i >= 0; i--)
+	{
+		uint64_t current = (remainder << 32) | a.limbs[i];
+		a.limbs[i] = (uint32_t)(current / 10);
+		remainder = current % 10;
+	}
+} // divide_by_ten
+
+bool parse_fixed_point(const char* text, FixedPoint& result)
+{
+	const char* p = text;
+	bool negative = false;
+	if (*p == '-' || *p == '+')
+	{
+		negative = *p == '-';
+		p++;
+	}
+
+	// Every digit, and how many of them come before the point
+	std::string digits;
+	int point = -1;
+	for (; *p != '\0'; p++)
+	{
+		if (*p >= '0' && *p <= '9')
+		{
+			digits += *p;
+		}
+		else if (*p == '.' && point < 0)
+		{
+			point = (int)digits.size();
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (digits.empty())
+	{
+		return false;
+	}
+	if (point < 0)
+	{
+		point = (int)digits.size();
+	}
+	// An exponent just moves the point
+	if (*p == 'e' || *p == 'E')
+	{
+		char* end;
+		point += (int)strtol(p + 1, &end, 10);
+		// "1e" or "1e+" has no exponent digits
+		if (end == p + 1)
+		{
+			return false;
+		}
+		p = end;
+	}
+	if (*p != '\0')
+	{
+		return false;
+	}
+
+	FixedPoint value;
+	// Integer part
+	uint64_t integer = 0;
+	for (int i = 0; i < point; i++)
+	{
+		integer = integer * 10 + (i < (int)digits.size() ? digits[i] - '0' : 0);
+		if (integer > 0xffffffffu)
+		{
+			return false;
+		}
+	}
+	value.limbs[FIXED_LIMBS - 1] = (uint32_t)integer;
+
+	// Fraction part, last digit first: fraction = (digit + fraction) / 10
+	FixedPoint fraction;
+	for (int i = (int)digits.size() - 1; i >= 0 && i >= point; i--)
+	{
+		fraction.limbs[FIXED_LIMBS - 1] = digits[i] - '0';
+		divide_by_ten(fraction);
+	}
+	// Digits between the point and the first one given, for text like 1e-5
+	for (int i = point; i < 0; i++)
+	{
+		divide_by_ten(fraction);
+	}
+
+	result = value + fraction;
+	if (negative)
+	{
+		result = -result;
+	}
+	return true;
+} // parse_fixed_point
@@ -0,0 +1,44 @@
+#pragma once
+
+// Fixed-point numbers with a few hundred bits after the point, for the view centre and the
+// perturbation reference orbit at zoom levels double-double can't reach.
+// Only add, subtract and multiply are needed for z = z^2 + c, so there is no division.
+#include <stdint.h>
+#include "DoubleDouble.h"
+
+// 32-bit limbs per number, the most significant one holds the integer part.
+// 15 fraction limbs are 480 bits (~144 decimal digits), enough for views down to around 1e-140.
+#define FIXED_LIMBS 16
+#define FIXED_FRACTION_BITS (32 * (FIXED_LIMBS - 1))
+
+// FixedPoint struct
+// Sign and magnitude, limbs[0] is the least significant. The integer part only has 32 bits,
+// which is plenty for points of the complex plane that haven't escaped.
+struct FixedPoint
+{
+	bool negative;
+	uint32_t limbs[FIXED_LIMBS];
+
+	FixedPoint();
+	// Exact for any double with a magnitude below 2^32, bits below 2^-480 are dropped
+	FixedPoint(double value);
+	FixedPoint(const DoubleDouble& value);
+};
+
+FixedPoint operator+(const FixedPoint& a, const FixedPoint& b);
+FixedPoint operator-(const FixedPoint& a);
+FixedPoint operator-(const FixedPoint& a, const FixedPoint& b);
+// Rounded towards zero to the last fraction bit
+FixedPoint operator*(const FixedPoint& a, const FixedPoint& b);
+FixedPoint& operator+=(FixedPoint& a, const FixedPoint& b);
+FixedPoint& operator-=(FixedPoint& a, const FixedPoint& b);
+bool operator==(const FixedPoint& a, const FixedPoint& b);
+bool operator!=(const FixedPoint& a, const FixedPoint& b);
+
+// Nearest double, and the nearest double-double for the double-double kernels
+double to_double(const FixedPoint& a);
+DoubleDouble to_double_double(const FixedPoint& a);
+
+// Read a decimal number such as "-0.7436438870371587047521" with every digit kept.
+// Returns false if the text isn't a number or its integer part doesn't fit.
+bool parse_fixed_point(const char* text, FixedPoint& result);
@@ -0,0 +1,119 @@
+#include "FrameBuffer.h"
+#include <new>
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+FrameBuffer::FrameBuffer()
+{
+	pixels = NULL;
+	frame_width = 0;
+	frame_height = 0;
+	row_stride = 0;
+}
+
+FrameBuffer::FrameBuffer(int width, int height)
+{
+	pixels = NULL;
+	frame_width = 0;
+	frame_height = 0;
+	row_stride = 0;
+	resize(width, height);
+}
+
+FrameBuffer::~FrameBuffer()
+{
+	release();
+}
+
+// Allocate an aligned buffer for width x height pixels
+void FrameBuffer::resize(int width, int height)
+{
+	if (width == frame_width && height == frame_height)
+	{
+		return;
+	}
+
+	// Free the old frame first, so growing to 8K doesn't need both in memory at once
+	release();
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	int stride = (int)((width + FRAME_STRIDE_PIXELS - 1) / FRAME_STRIDE_PIXELS * FRAME_STRIDE_PIXELS);
+	size_t size = (size_t)stride * height * sizeof(uint32_t);
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(size, FRAME_ALIGNMENT);
+#else
+	void* memory = NULL;
+	if (posix_memalign(&memory, FRAME_ALIGNMENT, size) != 0)
+	{
+		memory = NULL;
+	}
+#endif
+	if (!memory)
+	{
+		throw std::bad_alloc();
+	}
+
+	pixels = (uint32_t*)memory;
+	frame_width = width;
+	frame_height = height;
+	row_stride = stride;
+} // resize
+
+uint32_t* FrameBuffer::data()
+{
+	return pixels;
+} // data
+
+const uint32_t* FrameBuffer::data() const
+{
+	return pixels;
+} // data
+
+uint32_t* FrameBuffer::row(int y)
+{
+	return pixels + (size_t)y * row_stride;
+} // row
+
+const uint32_t* FrameBuffer::row(int y) const
+{
+	return pixels + (size_t)y * row_stride;
+} // row
+
+int FrameBuffer::width() const
+{
+	return frame_width;
+} // width
+
+int FrameBuffer::height() const
+{
+	return frame_height;
+} // height
+
+int FrameBuffer::stride() const
+{
+	return row_stride;
+} // stride
+
+size_t FrameBuffer::bytes() const
+{
+	return (size_t)row_stride * frame_height * sizeof(uint32_t);
+} // bytes
+
+// Free the pixels and go back to an empty 0 x 0 frame
+void FrameBuffer::release()
+{
+#ifdef _MSC_VER
+	_aligned_free(pixels);
+#else
+	free(pixels);
+#endif
+	pixels = NULL;
+	frame_width = 0;
+	frame_height = 0;
+	row_stride = 0;
+} // release
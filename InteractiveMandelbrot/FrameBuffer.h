@@ -0,0 +1,50 @@
+#pragma once
+
+// Image memory shared by every backend, no OpenGL so the batch renderer can use it too.
+#include <stddef.h>
+#include <stdint.h>
+
+// Rows start on a cache line boundary, and the buffer itself is aligned to one,
+// so a row never shares a line with the row before it
+#define FRAME_ALIGNMENT 64
+#define FRAME_STRIDE_PIXELS (FRAME_ALIGNMENT / sizeof(uint32_t))
+
+// FrameBuffer class
+// A width x height image, one uint32_t per pixel (red in the low byte, or an iteration count
+// before it is coloured), allocated to the exact size asked for. Each row is padded out to a multiple of FRAME_STRIDE_PIXELS, so
+// pixel (x, y) is at data()[y * stride() + x] rather than y * width() + x.
+class FrameBuffer
+{
+public:
+	FrameBuffer();
+	FrameBuffer(int width, int height);
+	~FrameBuffer();
+
+	// Reallocate for a new size, does nothing if the size hasn't changed.
+	// The contents are undefined afterwards. Throws std::bad_alloc if the memory isn't there.
+	void resize(int width, int height);
+
+	uint32_t* data();
+	const uint32_t* data() const;
+	uint32_t* row(int y);
+	const uint32_t* row(int y) const;
+
+	int width() const;
+	int height() const;
+	// Pixels from the start of one row to the start of the next
+	int stride() const;
+	// Bytes allocated, including the row padding
+	size_t bytes() const;
+
+protected:
+	// Owns the allocation, so no copying
+	FrameBuffer(const FrameBuffer&);
+	FrameBuffer& operator=(const FrameBuffer&);
+
+	void release();
+
+	uint32_t* pixels;
+	int frame_width;
+	int frame_height;
+	int row_stride;
+};
@@ -0,0 +1,188 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <fstream>
+
+const char* profile_stage_name(ProfileStage stage)
+{
+	switch (stage)
+	{
+	case STAGE_INPUT:
+		return "input";
+	case STAGE_COMPUTE:
+		return "compute";
+	case STAGE_COLOUR:
+		return "colour";
+	case STAGE_UPLOAD:
+		return "upload";
+	default:
+		return "hud";
+	}
+} // profile_stage_name
+
+FrameProfiler::FrameProfiler()
+{
+	epoch = std::chrono::steady_clock::now();
+	for (int i = 0; i < PROFILE_RING_SIZE; i++)
+	{
+		slots[i].sequence = 0;
+	}
+	next = 0;
+	refreshed_ns = 0;
+	for (int i = 0; i < STAGE_COUNT; i++)
+	{
+		median[i] = 0.0;
+		tail[i] = 0.0;
+	}
+}
+
+long long FrameProfiler::now() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+} // now
+
+// The sequence number is cleared before the fields change and set after, with the fences
+// ordering them, so a reader that sees the same number either side saw one whole sample
+void FrameProfiler::record(ProfileStage stage, long long start_ns, long long duration_ns, unsigned long long frame)
+{
+	unsigned long long index = next.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[index % PROFILE_RING_SIZE];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.stage.store(stage, std::memory_order_relaxed);
+	slot.thread.store(threadNumber(), std::memory_order_relaxed);
+	slot.start_ns.store(start_ns, std::memory_order_relaxed);
+	slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+	slot.frame.store(frame, std::memory_order_relaxed);
+	slot.sequence.store(index + 1, std::memory_order_release);
+} // record
+
+// Newest samples first, so each stage's window is its most recent ones
+void FrameProfiler::refresh()
+{
+	long long time = now();
+	if (refreshed_ns != 0 && time - refreshed_ns < PROFILE_REFRESH_MS * 1000000ll)
+	{
+		return;
+	}
+	refreshed_ns = time;
+
+	std::vector<Sample> samples;
+	snapshot(samples);
+	std::vector<long long> durations;
+	for (int stage = 0; stage < STAGE_COUNT; stage++)
+	{
+		durations.clear();
+		for (size_t i = samples.size(); i-- > 0 && durations.size() < PROFILE_WINDOW;)
+		{
+			if (samples[i].stage == stage)
+			{
+				durations.push_back(samples[i].duration_ns);
+			}
+		}
+		if (durations.empty())
+		{
+			median[stage] = 0.0;
+			tail[stage] = 0.0;
+			continue;
+		}
+		size_t middle = durations.size() / 2;
+		size_t high = std::min(durations.size() - 1, durations.size() * 99 / 100);
+		std::nth_element(durations.begin(), durations.begin() + high, durations.end());
+		tail[stage] = durations[high] / 1e6;
+		// Everything past high is at least as large, so the median is in front of it
+		std::nth_element(durations.begin(), durations.begin() + middle, durations.begin() + high + 1);
+		median[stage] = durations[middle] / 1e6;
+	}
+} // refresh
+
+double FrameProfiler::p50(ProfileStage stage) const
+{
+	return median[stage];
+} // p50
+
+double FrameProfiler::p99(ProfileStage stage) const
+{
+	return tail[stage];
+} // p99
+
+// Complete events ("ph": "X") with microsecond times, one track per thread
+int FrameProfiler::writeTrace(const std::string& path) const
+{
+	std::ofstream file(path.c_str());
+	if (!file)
+	{
+		return -1;
+	}
+	std::vector<Sample> samples;
+	snapshot(samples);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	// Name the tracks after what runs on them
+	unsigned worker_thread = 0;
+	unsigned render_thread = 0;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		(samples[i].stage == STAGE_COMPUTE ? worker_thread : render_thread) = samples[i].thread;
+	}
+	// Thread numbers start at 1, 0 is one with no samples left in the ring
+	const char* separator = "";
+	if (render_thread != 0)
+	{
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << render_thread << ",\"args\":{\"name\":\"render\"}}";
+		separator = ",\n";
+	}
+	if (worker_thread != 0)
+	{
+		file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << worker_thread << ",\"args\":{\"name\":\"worker\"}}";
+		separator = ",\n";
+	}
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const Sample& s = samples[i];
+		file << separator << "{\"name\":\"" << profile_stage_name(s.stage) << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+			<< ",\"ts\":" << s.start_ns / 1000.0 << ",\"dur\":" << s.duration_ns / 1000.0
+			<< ",\"args\":{\"frame\":" << s.frame << "}}";
+		separator = ",\n";
+	}
+	file << "\n]}\n";
+	return file ? (int)samples.size() : -1;
+} // writeTrace
+
+// The slot of sample index holds index + 1 once it is complete, anything else is being written
+// or has been overwritten since
+void FrameProfiler::snapshot(std::vector<Sample>& samples) const
+{
+	samples.clear();
+	unsigned long long end = next.load(std::memory_order_acquire);
+	unsigned long long begin = end > PROFILE_RING_SIZE ? end - PROFILE_RING_SIZE : 0;
+	samples.reserve((size_t)(end - begin));
+	for (unsigned long long index = begin; index < end; index++)
+	{
+		const Slot& slot = slots[index % PROFILE_RING_SIZE];
+		if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+		{
+			continue;
+		}
+		Sample s;
+		s.stage = (ProfileStage)slot.stage.load(std::memory_order_relaxed);
+		s.thread = slot.thread.load(std::memory_order_relaxed);
+		s.start_ns = slot.start_ns.load(std::memory_order_relaxed);
+		s.duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+		s.frame = slot.frame.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) == index + 1)
+		{
+			samples.push_back(s);
+		}
+	}
+} // snapshot
+
+unsigned FrameProfiler::threadNumber()
+{
+	static std::atomic<unsigned> threads(0);
+	thread_local unsigned number = ++threads;
+	return number;
+} // threadNumber
@@ -0,0 +1,94 @@
+#pragma once
+
+// Records how long each stage of a frame takes, from the render thread and the worker.
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Samples kept, the oldest are overwritten first. Several seconds of frames at display rate.
+#define PROFILE_RING_SIZE 4096
+// Most recent samples of a stage its percentiles are taken over
+#define PROFILE_WINDOW 256
+// Milliseconds between working the percentiles out again, so the HUD stays readable
+#define PROFILE_REFRESH_MS 500
+
+// Parts of a frame that are timed
+enum ProfileStage
+{
+	// Key handlers, swapping in a finished frame and handing the next to the worker, on the render thread
+	STAGE_INPUT,
+	// Computing the counts, on the worker
+	STAGE_COMPUTE,
+	// Colour pass and texture upload, on the render thread
+	STAGE_COLOUR,
+	STAGE_UPLOAD,
+	// Formatting and drawing the HUD
+	STAGE_HUD,
+	STAGE_COUNT
+};
+
+// Display name of a stage, for the HUD and the trace
+const char* profile_stage_name(ProfileStage stage);
+
+// FrameProfiler class
+// A ring of timing samples that any thread can add to without taking a lock. A writer claims a
+// slot with one atomic increment, and publishes it by storing its sequence number last. A reader
+// only keeps a slot if its sequence number is the one expected both before and after copying it,
+// so a slot overwritten while being read is skipped rather than read torn.
+// The render thread reads the ring to work out each stage's median and 99th percentile for the
+// HUD, and to write a Chrome trace (chrome://tracing or Perfetto) of every sample still in it.
+class FrameProfiler
+{
+public:
+	FrameProfiler();
+
+	// Nanoseconds since the profiler was created, what samples are timed in
+	long long now() const;
+	// Add a sample of stage that started at start_ns and took duration_ns. frame is the render
+	// thread's frame number, or the worker's job generation for STAGE_COMPUTE.
+	void record(ProfileStage stage, long long start_ns, long long duration_ns, unsigned long long frame);
+
+	// Work the percentiles out again once PROFILE_REFRESH_MS has passed since the last time
+	void refresh();
+	// Median and 99th percentile of a stage's last PROFILE_WINDOW samples, in milliseconds
+	double p50(ProfileStage stage) const;
+	double p99(ProfileStage stage) const;
+
+	// Write every sample in the ring to path as Chrome trace event JSON. Returns the number of
+	// events written, or -1 if the file couldn't be opened.
+	int writeTrace(const std::string& path) const;
+
+protected:
+	struct Sample
+	{
+		ProfileStage stage;
+		unsigned thread;
+		long long start_ns, duration_ns;
+		unsigned long long frame;
+	};
+	// Every field is atomic, so copying one that is being written is a stale read, not a race
+	struct Slot
+	{
+		// Index of the sample in it plus one, 0 while it is being written
+		std::atomic<unsigned long long> sequence;
+		std::atomic<int> stage;
+		std::atomic<unsigned> thread;
+		std::atomic<long long> start_ns, duration_ns;
+		std::atomic<unsigned long long> frame;
+	};
+
+	// Copy the samples that are complete out of the ring, oldest first
+	void snapshot(std::vector<Sample>& samples) const;
+	// Small number for the calling thread, numbered as they first record a sample
+	static unsigned threadNumber();
+
+	std::chrono::steady_clock::time_point epoch;
+	Slot slots[PROFILE_RING_SIZE];
+	std::atomic<unsigned long long> next;
+
+	// Only used by the render thread
+	long long refreshed_ns;
+	double median[STAGE_COUNT];
+	double tail[STAGE_COUNT];
+};
@@ -0,0 +1,32 @@
+#include "GLFunctions.h"
+
+// Address of an entry point, or NULL
+static void* gl_proc(const char* name)
+{
+	void* proc = (void*)wglGetProcAddress(name);
+	// Some drivers return small values or -1 rather than NULL for ones they don't have
+	if (proc == (void*)1 || proc == (void*)2 || proc == (void*)3 || proc == (void*)-1)
+	{
+		return NULL;
+	}
+	return proc;
+} // gl_proc
+
+void load_gl_functions(GLFunctions& gl)
+{
+	gl.genBuffers = (GLGenBuffersProc)gl_proc("glGenBuffers");
+	gl.deleteBuffers = (GLDeleteBuffersProc)gl_proc("glDeleteBuffers");
+	gl.bindBuffer = (GLBindBufferProc)gl_proc("glBindBuffer");
+	gl.bufferData = (GLBufferDataProc)gl_proc("glBufferData");
+	gl.mapBufferRange = (GLMapBufferRangeProc)gl_proc("glMapBufferRange");
+	gl.unmapBuffer = (GLUnmapBufferProc)gl_proc("glUnmapBuffer");
+	gl.bufferStorage = (GLBufferStorageProc)gl_proc("glBufferStorage");
+	gl.fenceSync = (GLFenceSyncProc)gl_proc("glFenceSync");
+	gl.clientWaitSync = (GLClientWaitSyncProc)gl_proc("glClientWaitSync");
+	gl.deleteSync = (GLDeleteSyncProc)gl_proc("glDeleteSync");
+	gl.genFramebuffers = (GLGenFramebuffersProc)gl_proc("glGenFramebuffers");
+	gl.deleteFramebuffers = (GLDeleteFramebuffersProc)gl_proc("glDeleteFramebuffers");
+	gl.bindFramebuffer = (GLBindFramebufferProc)gl_proc("glBindFramebuffer");
+	gl.framebufferTexture2D = (GLFramebufferTexture2DProc)gl_proc("glFramebufferTexture2D");
+	gl.checkFramebufferStatus = (GLCheckFramebufferStatusProc)gl_proc("glCheckFramebufferStatus");
+} // load_gl_functions
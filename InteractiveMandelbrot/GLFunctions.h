@@ -0,0 +1,99 @@
+#pragma once
+
+// OpenGL entry points past 1.1, which is all opengl32.lib exports on Windows. They are looked up
+// from the driver with wglGetProcAddress once a context exists, so the program still starts (and
+// falls back to 1.1 calls) on drivers that don't have them.
+#include "glut.h"
+#include <gl/GL.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Types and values from glext.h that the 1.1 header doesn't have
+typedef ptrdiff_t GLsizeiptr;
+typedef ptrdiff_t GLintptr;
+typedef struct __GLsync* GLsync;
+typedef uint64_t GLuint64;
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+typedef void (APIENTRY* GLGenBuffersProc)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* GLDeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* GLBindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* GLBufferDataProc)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+typedef void (APIENTRY* GLBufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void* (APIENTRY* GLMapBufferRangeProc)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRY* GLUnmapBufferProc)(GLenum target);
+typedef GLsync (APIENTRY* GLFenceSyncProc)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY* GLClientWaitSyncProc)(GLsync sync, GLbitfield flags, GLuint64 timeout);
+typedef void (APIENTRY* GLDeleteSyncProc)(GLsync sync);
+typedef void (APIENTRY* GLGenFramebuffersProc)(GLsizei n, GLuint* framebuffers);
+typedef void (APIENTRY* GLDeleteFramebuffersProc)(GLsizei n, const GLuint* framebuffers);
+typedef void (APIENTRY* GLBindFramebufferProc)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY* GLFramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY* GLCheckFramebufferStatusProc)(GLenum target);
+
+// GLFunctions struct
+// The entry points the program uses past 1.1, null where the driver doesn't have one
+struct GLFunctions
+{
+	// Buffer objects (1.5)
+	GLGenBuffersProc genBuffers;
+	GLDeleteBuffersProc deleteBuffers;
+	GLBindBufferProc bindBuffer;
+	GLBufferDataProc bufferData;
+	// Mapping part of a buffer (3.0), and immutable storage that can stay mapped (4.4)
+	GLMapBufferRangeProc mapBufferRange;
+	GLUnmapBufferProc unmapBuffer;
+	GLBufferStorageProc bufferStorage;
+	// Fences (3.2)
+	GLFenceSyncProc fenceSync;
+	GLClientWaitSyncProc clientWaitSync;
+	GLDeleteSyncProc deleteSync;
+	// Framebuffer objects (3.0 / ARB_framebuffer_object)
+	GLGenFramebuffersProc genFramebuffers;
+	GLDeleteFramebuffersProc deleteFramebuffers;
+	GLBindFramebufferProc bindFramebuffer;
+	GLFramebufferTexture2DProc framebufferTexture2D;
+	GLCheckFramebufferStatusProc checkFramebufferStatus;
+};
+
+// Look up every entry point in GLFunctions for the current context
+void load_gl_functions(GLFunctions& gl);
@@ -0,0 +1,259 @@
+#include "HudText.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+HudText::HudText()
+{
+	gl = GLFunctions();
+	atlas = 0;
+	vertex_buffer = 0;
+	for (int i = 0; i <= HUD_LAST_CHAR - HUD_FIRST_CHAR; i++)
+	{
+		glyphs[i] = Glyph();
+	}
+	used = 0;
+	built = 0;
+	changed = false;
+	built_width = 0;
+	built_height = 0;
+}
+
+HudText::~HudText()
+{
+	if (vertex_buffer != 0)
+	{
+		gl.deleteBuffers(1, &vertex_buffer);
+	}
+	if (atlas != 0)
+	{
+		glDeleteTextures(1, &atlas);
+	}
+}
+
+void HudText::init(const GLFunctions& functions, void* font)
+{
+	gl = functions;
+	buildAtlas(font);
+	if (gl.genBuffers && gl.deleteBuffers && gl.bindBuffer && gl.bufferData)
+	{
+		gl.genBuffers(1, &vertex_buffer);
+	}
+} // init
+
+void HudText::begin()
+{
+	used = 0;
+} // begin
+
+// Set the matrices up so vertices are in pixels, then one draw call for every quad
+void HudText::draw(int window_width, int window_height)
+{
+	if (changed || used != built || window_width != built_width || window_height != built_height)
+	{
+		buildVertices(window_width, window_height);
+	}
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, window_width, 0.0, window_height, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_TEXTURE_2D);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	// The atlas only has alpha, the colour comes from here
+	glColor3f(1.f, 1.f, 1.f);
+
+	// With a buffer bound the pointers are offsets into it
+	const char* base = (const char*)vertices.data();
+	if (vertex_buffer != 0)
+	{
+		gl.bindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		base = NULL;
+	}
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, x));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, u));
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (vertex_buffer != 0)
+	{
+		gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glPopAttrib();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+} // draw
+
+void HudText::appendKey(std::string& key, const char* value)
+{
+	// Including the terminator, so "ab", "c" and "a", "bc" differ
+	key.append(value, strlen(value) + 1);
+} // appendKey
+
+void HudText::appendKey(std::string& key, char* value)
+{
+	appendKey(key, (const char*)value);
+} // appendKey
+
+void HudText::appendKeys(std::string& key)
+{
+} // appendKeys
+
+// Each glyph is drawn with glutBitmapCharacter at the same offset from its cell as the pen would
+// be, so a quad placed at the pen covers exactly the pixels it would have drawn
+void HudText::buildAtlas(void* font)
+{
+	// Lay the glyphs out in rows, a new row when the next doesn't fit
+	int x = 0;
+	int y = 0;
+	for (int c = HUD_FIRST_CHAR; c <= HUD_LAST_CHAR; c++)
+	{
+		Glyph& glyph = glyphs[c - HUD_FIRST_CHAR];
+		glyph.advance = glutBitmapWidth(font, c);
+		glyph.width = glyph.advance + 2 * HUD_GLYPH_PAD;
+		if (x + glyph.width > HUD_ATLAS_WIDTH)
+		{
+			x = 0;
+			y += HUD_GLYPH_HEIGHT;
+		}
+		glyph.x = x;
+		glyph.y = y;
+		x += glyph.width;
+	}
+
+	// Off screen if the driver can, the window might not be as big as the atlas
+	GLuint framebuffer = 0;
+	GLuint target = 0;
+	if (gl.genFramebuffers && gl.deleteFramebuffers && gl.bindFramebuffer && gl.framebufferTexture2D && gl.checkFramebufferStatus)
+	{
+		glGenTextures(1, &target);
+		glBindTexture(GL_TEXTURE_2D, target);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		gl.genFramebuffers(1, &framebuffer);
+		gl.bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		gl.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+		if (gl.checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
+			gl.deleteFramebuffers(1, &framebuffer);
+			glDeleteTextures(1, &target);
+			framebuffer = 0;
+		}
+	}
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, HUD_ATLAS_WIDTH, 0.0, HUD_ATLAS_HEIGHT, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT | GL_VIEWPORT_BIT);
+
+	glViewport(0, 0, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT);
+	glDisable(GL_TEXTURE_2D);
+	glDisable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glColor3f(1.f, 1.f, 1.f);
+	for (int c = HUD_FIRST_CHAR; c <= HUD_LAST_CHAR; c++)
+	{
+		const Glyph& glyph = glyphs[c - HUD_FIRST_CHAR];
+		glRasterPos2i(glyph.x + HUD_GLYPH_PAD, glyph.y + HUD_GLYPH_DESCENT);
+		glutBitmapCharacter(font, c);
+	}
+
+	// White on black, so any channel is how much of the pixel the glyph covers
+	std::vector<GLubyte> pixels((size_t)HUD_ATLAS_WIDTH * HUD_ATLAS_HEIGHT * 4);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	std::vector<GLubyte> coverage((size_t)HUD_ATLAS_WIDTH * HUD_ATLAS_HEIGHT);
+	for (size_t i = 0; i < coverage.size(); i++)
+	{
+		coverage[i] = pixels[i * 4];
+	}
+	// Don't leave the glyphs in the back buffer
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glPopAttrib();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+
+	if (framebuffer != 0)
+	{
+		gl.bindFramebuffer(GL_FRAMEBUFFER, 0);
+		gl.deleteFramebuffers(1, &framebuffer);
+		glDeleteTextures(1, &target);
+	}
+
+	// Sampled texel for pixel, so nearest
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_2D, atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, coverage.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+} // buildAtlas
+
+// Two triangles per character, the pen starts on the pixel glRasterPos2f would have put it on
+void HudText::buildVertices(int window_width, int window_height)
+{
+	vertices.clear();
+	for (size_t i = 0; i < used; i++)
+	{
+		const Line& line = lines[i];
+		float pen = floorf((line.x + 1.0f) * 0.5f * window_width);
+		float baseline = floorf((line.y + 1.0f) * 0.5f * window_height);
+		for (const char* c = line.text; *c != '\0'; c++)
+		{
+			int index = *c >= HUD_FIRST_CHAR && *c <= HUD_LAST_CHAR ? *c - HUD_FIRST_CHAR : 0;
+			const Glyph& glyph = glyphs[index];
+			float left = pen - HUD_GLYPH_PAD;
+			float bottom = baseline - HUD_GLYPH_DESCENT;
+			float right = left + glyph.width;
+			float top = bottom + HUD_GLYPH_HEIGHT;
+			float u0 = (float)glyph.x / HUD_ATLAS_WIDTH;
+			float v0 = (float)glyph.y / HUD_ATLAS_HEIGHT;
+			float u1 = (float)(glyph.x + glyph.width) / HUD_ATLAS_WIDTH;
+			float v1 = (float)(glyph.y + HUD_GLYPH_HEIGHT) / HUD_ATLAS_HEIGHT;
+			Vertex quad[6] =
+			{
+				{ left, bottom, u0, v0 }, { right, bottom, u1, v0 }, { right, top, u1, v1 },
+				{ left, bottom, u0, v0 }, { right, top, u1, v1 }, { left, top, u0, v1 }
+			};
+			vertices.insert(vertices.end(), quad, quad + 6);
+			pen += glyph.advance;
+		}
+	}
+
+	if (vertex_buffer != 0 && !vertices.empty())
+	{
+		gl.bindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		gl.bufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+		gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	built = used;
+	built_width = window_width;
+	built_height = window_height;
+	changed = false;
+} // buildVertices
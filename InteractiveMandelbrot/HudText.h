@@ -0,0 +1,131 @@
+#pragma once
+
+// Draws the HUD's lines of text from a glyph atlas, in one batched call.
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "GLFunctions.h"
+
+// Size of the atlas texture the font's glyphs are rendered into
+#define HUD_ATLAS_WIDTH 256
+#define HUD_ATLAS_HEIGHT 128
+// Height of a row of glyphs in the atlas, and how far their baseline is above its bottom
+#define HUD_GLYPH_HEIGHT 16
+#define HUD_GLYPH_DESCENT 4
+// Pixels either side of a glyph's advance, for the ones that reach past it
+#define HUD_GLYPH_PAD 2
+// Characters in the atlas, printable ASCII. Anything else is drawn as a space.
+#define HUD_FIRST_CHAR 32
+#define HUD_LAST_CHAR 126
+// Longest line print() formats
+#define HUD_LINE_CHARS 160
+
+// HudText class
+// Renders each glyph of a GLUT bitmap font once into an atlas texture, so the HUD looks the same
+// as drawing it with glutBitmapCharacter, then draws every line as textured quads from one vertex
+// buffer with a single glDrawArrays. Lines are only formatted again, and the buffer only filled
+// again, when the values printed into them change.
+class HudText
+{
+public:
+	HudText();
+	~HudText();
+
+	// Render the font into the atlas and create the vertex buffer, needs the GL context to be current
+	void init(const GLFunctions& functions, void* font);
+
+	// Start the lines of a new frame, print() adds them in the same order each frame
+	void begin();
+	// Add a line with its baseline starting at x, y in -1 to 1 across the window (where displayText
+	// put it with glRasterPos2f). Formatted with sprintf_s, only if the position, format or
+	// values differ from the line printed in the same place last frame.
+	template <typename... Values>
+	void print(float x, float y, const char* format, Values... values);
+	// Draw every line printed since begin()
+	void draw(int window_width, int window_height);
+
+protected:
+	// Where a character is in the atlas, and how far it moves the pen
+	struct Glyph
+	{
+		int x, y;
+		int width;
+		int advance;
+	};
+	// One line of text, and the bytes of what it was formatted from
+	struct Line
+	{
+		std::string key;
+		float x, y;
+		char text[HUD_LINE_CHARS];
+	};
+	struct Vertex
+	{
+		float x, y;
+		float u, v;
+	};
+
+	// The bytes of a value, or the characters of a string, compared instead of the formatted text
+	static void appendKey(std::string& key, const char* value);
+	static void appendKey(std::string& key, char* value);
+	template <typename T>
+	static void appendKey(std::string& key, const T& value);
+	static void appendKeys(std::string& key);
+	template <typename T, typename... Rest>
+	static void appendKeys(std::string& key, const T& value, const Rest&... rest);
+
+	// Render the glyphs off screen (or in the back buffer without framebuffer objects) and read them back
+	void buildAtlas(void* font);
+	// Fill the vertex buffer with a quad for every character of every line
+	void buildVertices(int window_width, int window_height);
+
+	GLFunctions gl;
+	GLuint atlas;
+	// Vertex buffer, 0 to draw from vertices in client memory instead
+	GLuint vertex_buffer;
+	Glyph glyphs[HUD_LAST_CHAR - HUD_FIRST_CHAR + 1];
+
+	std::vector<Line> lines;
+	// Lines printed this frame and when the vertices were last built
+	size_t used, built;
+	bool changed;
+	std::string key;
+
+	std::vector<Vertex> vertices;
+	int built_width, built_height;
+};
+
+template <typename T>
+void HudText::appendKey(std::string& key, const T& value)
+{
+	key.append((const char*)&value, sizeof(value));
+} // appendKey
+
+template <typename T, typename... Rest>
+void HudText::appendKeys(std::string& key, const T& value, const Rest&... rest)
+{
+	appendKey(key, value);
+	appendKeys(key, rest...);
+} // appendKeys
+
+// Building the key is much cheaper than formatting floats, and most lines don't change between frames
+template <typename... Values>
+void HudText::print(float x, float y, const char* format, Values... values)
+{
+	key.clear();
+	appendKeys(key, x, y, format, values...);
+	if (used == lines.size())
+	{
+		lines.push_back(Line());
+	}
+	Line& line = lines[used++];
+	if (line.key == key)
+	{
+		return;
+	}
+	line.key = key;
+	line.x = x;
+	line.y = y;
+	sprintf_s(line.text, format, values...);
+	changed = true;
+} // print
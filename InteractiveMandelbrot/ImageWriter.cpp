@@ -0,0 +1,232 @@
+#include "ImageWriter.h"
+#include <string.h>
+
+// Largest block deflate can store without compressing it
+#define STORED_BLOCK_SIZE 65535
+
+// fopen is deprecated (an error with /sdl) under MSVC
+static FILE* open_for_writing(const char* filename)
+{
+#ifdef _MSC_VER
+	FILE* file = NULL;
+	if (fopen_s(&file, filename, "wb") != 0)
+	{
+		return NULL;
+	}
+	return file;
+#else
+	return fopen(filename, "wb");
+#endif
+} // open_for_writing
+
+// Write a binary (P6) PPM in one go
+bool write_ppm(const char* filename, const uint32_t* image, int width, int height, int stride)
+{
+	PpmStreamWriter writer;
+	if (!writer.open(filename, width, height))
+	{
+		return false;
+	}
+	writer.writeRows(image, height, stride);
+	return writer.close();
+} // write_ppm
+
+// CRC-32 as used by PNG chunks
+static uint32_t png_crc(uint32_t crc, const unsigned char* data, size_t length)
+{
+	static uint32_t table[256];
+	static bool table_ready = false;
+	if (!table_ready)
+	{
+		for (uint32_t n = 0; n < 256; n++)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++)
+			{
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		table_ready = true;
+	}
+
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+} // png_crc
+
+// Append a 32-bit value most significant byte first, the byte order PNG uses throughout
+static void put_u32(std::vector<unsigned char>& out, uint32_t value)
+{
+	out.push_back((value >> 24) & 0xFF);
+	out.push_back((value >> 16) & 0xFF);
+	out.push_back((value >> 8) & 0xFF);
+	out.push_back(value & 0xFF);
+} // put_u32
+
+// Write one chunk: length, type, data, CRC of type and data
+static bool write_chunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+{
+	std::vector<unsigned char> header;
+	put_u32(header, (uint32_t)data.size());
+	header.insert(header.end(), type, type + 4);
+
+	uint32_t crc = png_crc(0, header.data() + 4, 4);
+	crc = png_crc(crc, data.data(), data.size());
+	std::vector<unsigned char> footer;
+	put_u32(footer, crc);
+
+	return fwrite(header.data(), 1, header.size(), file) == header.size()
+		&& fwrite(data.data(), 1, data.size(), file) == data.size()
+		&& fwrite(footer.data(), 1, footer.size(), file) == footer.size();
+} // write_chunk
+
+// Write an 8-bit RGB PNG with the image data in stored deflate blocks
+bool write_png(const char* filename, const uint32_t* image, int width, int height, int stride)
+{
+	// Scanlines as PNG wants them, a filter type byte (0, none) then RGB triples
+	size_t row_bytes = (size_t)width * 3 + 1;
+	std::vector<unsigned char> raw(row_bytes * height);
+	for (int y = 0; y < height; y++)
+	{
+		const uint32_t* pixels = image + (size_t)y * stride;
+		unsigned char* row = raw.data() + (size_t)y * row_bytes;
+		row[0] = 0;
+		for (int x = 0; x < width; x++)
+		{
+			row[1 + x * 3 + 0] = pixels[x] & 0xFF;
+			row[1 + x * 3 + 1] = (pixels[x] >> 8) & 0xFF;
+			row[1 + x * 3 + 2] = (pixels[x] >> 16) & 0xFF;
+		}
+	}
+
+	// zlib stream: header, stored blocks, Adler-32 of the uncompressed data
+	std::vector<unsigned char> idat;
+	idat.reserve(raw.size() + raw.size() / STORED_BLOCK_SIZE * 5 + 16);
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	size_t offset = 0;
+	do
+	{
+		size_t block = raw.size() - offset < STORED_BLOCK_SIZE ? raw.size() - offset : STORED_BLOCK_SIZE;
+		bool last = offset + block == raw.size();
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(block & 0xFF);
+		idat.push_back((block >> 8) & 0xFF);
+		idat.push_back(~block & 0xFF);
+		idat.push_back((~block >> 8) & 0xFF);
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + block);
+		offset += block;
+	} while (offset < raw.size());
+
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	put_u32(idat, (b << 16) | a);
+
+	std::vector<unsigned char> ihdr;
+	put_u32(ihdr, width);
+	put_u32(ihdr, height);
+	ihdr.push_back(8);	// bit depth
+	ihdr.push_back(2);	// colour type, RGB
+	ihdr.push_back(0);	// compression method
+	ihdr.push_back(0);	// filter method
+	ihdr.push_back(0);	// no interlacing
+
+	FILE* file = open_for_writing(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	bool ok = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature)
+		&& write_chunk(file, "IHDR", ihdr)
+		&& write_chunk(file, "IDAT", idat)
+		&& write_chunk(file, "IEND", std::vector<unsigned char>());
+
+	ok = fclose(file) == 0 && ok;
+	return ok;
+} // write_png
+
+// Choose PNG or PPM from the extension
+bool write_image(const char* filename, const uint32_t* image, int width, int height, int stride)
+{
+	size_t length = strlen(filename);
+	if (length >= 4 && (strcmp(filename + length - 4, ".png") == 0 || strcmp(filename + length - 4, ".PNG") == 0))
+	{
+		return write_png(filename, image, width, height, stride);
+	}
+	return write_ppm(filename, image, width, height, stride);
+} // write_image
+
+PpmStreamWriter::PpmStreamWriter()
+{
+	file = NULL;
+	image_width = 0;
+	image_height = 0;
+	rows_written = 0;
+	ok = false;
+}
+
+PpmStreamWriter::~PpmStreamWriter()
+{
+	close();
+}
+
+bool PpmStreamWriter::open(const char* filename, int width, int height)
+{
+	close();
+	file = open_for_writing(filename);
+	if (!file)
+	{
+		return false;
+	}
+	image_width = width;
+	image_height = height;
+	rows_written = 0;
+	row_bytes.resize((size_t)width * 3);
+	ok = fprintf(file, "P6\n%d %d\n255\n", width, height) > 0;
+	return ok;
+} // open
+
+// Convert each row to RGB triples and append it
+bool PpmStreamWriter::writeRows(const uint32_t* image, int rows, int stride)
+{
+	if (!file || !ok || rows_written + rows > image_height)
+	{
+		ok = false;
+		return false;
+	}
+
+	for (int y = 0; y < rows && ok; y++)
+	{
+		const uint32_t* pixels = image + (size_t)y * stride;
+		for (int x = 0; x < image_width; x++)
+		{
+			row_bytes[x * 3 + 0] = pixels[x] & 0xFF;
+			row_bytes[x * 3 + 1] = (pixels[x] >> 8) & 0xFF;
+			row_bytes[x * 3 + 2] = (pixels[x] >> 16) & 0xFF;
+		}
+		ok = fwrite(row_bytes.data(), 1, row_bytes.size(), file) == row_bytes.size();
+	}
+	rows_written += rows;
+	return ok;
+} // writeRows
+
+bool PpmStreamWriter::close()
+{
+	if (!file)
+	{
+		return false;
+	}
+	bool closed = fclose(file) == 0;
+	file = NULL;
+	return closed && ok && rows_written == image_height;
+} // close
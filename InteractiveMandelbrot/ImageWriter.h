@@ -0,0 +1,44 @@
+#pragma once
+
+// Saves a computed frame to disk without going through OpenGL/SOIL.
+// Both formats take the image exactly as the backends fill it, one uint32_t per pixel
+// holding red in the low byte, then green, then blue, and stride pixels per row.
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// Write a binary (P6) PPM, returns false if the file can't be written
+bool write_ppm(const char* filename, const uint32_t* image, int width, int height, int stride);
+
+// Write an 8-bit RGB PNG, returns false if the file can't be written.
+// The pixel data is stored uncompressed (deflate "stored" blocks), which every
+// PNG reader accepts and keeps the writer free of a zlib dependency.
+bool write_png(const char* filename, const uint32_t* image, int width, int height, int stride);
+
+// Pick the format from the file extension (.png, anything else is written as PPM)
+bool write_image(const char* filename, const uint32_t* image, int width, int height, int stride);
+
+// PpmStreamWriter class
+// Writes a P6 PPM a band of rows at a time, so an image far bigger than memory can be
+// saved as it is computed. The header goes out on open, rows are appended top to bottom.
+class PpmStreamWriter
+{
+public:
+	PpmStreamWriter();
+	~PpmStreamWriter();
+
+	// Create the file and write the header for a width x height image
+	bool open(const char* filename, int width, int height);
+	// Append rows of width pixels, stride pixels apart
+	bool writeRows(const uint32_t* image, int rows, int stride);
+	// Flush and close, false if anything failed to write or fewer rows than height were written
+	bool close();
+
+protected:
+	FILE* file;
+	int image_width;
+	int image_height;
+	int rows_written;
+	bool ok;
+	std::vector<unsigned char> row_bytes;
+};
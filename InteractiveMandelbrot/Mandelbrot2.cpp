@@ -1,5 +1,22 @@
 #include "Mandelbrot2.h"
-#include "complex_amp.h"
+#include <cmath>
+#include <stddef.h>
+
+// Vertex of the quad the image is drawn on
+struct QuadVertex
+{
+	float x, y, z;
+	float u, v;
+};
+
+// Bottom right, top right, top left, bottom left, a fan of two triangles
+static const QuadVertex quad_vertices[4] =
+{
+	{ 1.0f, -1.0f, 0.0f, 1.0f, 1.0f },
+	{ 1.0f, 1.0f, 0.0f, 1.0f, 0.0f },
+	{ -1.0f, 1.0f, 0.0f, 0.0f, 0.0f },
+	{ -1.0f, -1.0f, 0.0f, 0.0f, 1.0f }
+};
 
 Mandelbrot2::Mandelbrot2(Input *in)
 {
@@ -22,11 +39,14 @@ Mandelbrot2::Mandelbrot2(Input *in)
 
 	// Initialise texutre
 	initTexture();
+
+	// Initialise the quad and HUD text
+	initGeometry();
 }
 
 Mandelbrot2::~Mandelbrot2()
 {
-	mandelbrot_timings_file.close();
+	// The timing log writes out whatever is still queued as it is destroyed
 }
 
 // Render the scene
@@ -46,10 +66,8 @@ void Mandelbrot2::render()
 
 	// End render geometry --------------------------------------
 
-	glDisable(GL_TEXTURE_2D);
 	// Render text, should be last object rendered.
 	renderTextOutput();
-	glEnable(GL_TEXTURE_2D);
 
 	// Swap buffers, after all objects are rendered.
 	glutSwapBuffers();
@@ -58,6 +76,8 @@ void Mandelbrot2::render()
 // Update the scene
 void Mandelbrot2::update(float dt)
 {
+	long long input_start = profiler.now();
+
 	setWidth_Height();
 
 	alterMovementModifierByZoomLevel();
@@ -72,41 +92,116 @@ void Mandelbrot2::update(float dt)
 
 	setComputation();
 
+	writeTrace();
+
+	// Swap in a frame the worker has finished, the one it replaces becomes the next back buffer
+	if (worker.finished())
+	{
+		collectFrame();
+	}
+
 	// update scene related variables.
 	if (recalculate)
 	{
-		// Start timing
-		the_amp_clock::time_point start = the_amp_clock::now();
+		RenderJob job;
+		// The centre stays in fixed point so panning keeps working at any depth
+		job.view = make_viewport(X_Modifier_, Y_Modifier_, zoom_);
+		job.settings = currentFrameSettings();
+		job.pan_x = 0;
+		job.pan_y = 0;
+		job.step = 0;
+		job.previous_step = 0;
+		job.use_cache = tile_cache_on;
+		job.deadline = the_amp_clock::time_point::max();
+		// The view is changing faster than frames finish, don't let this one hold the next up
+		if (worker.busy() && cpuMode(computation_mode))
+		{
+			job.deadline = the_amp_clock::now() + milliseconds(FRAME_DEADLINE_MS);
+		}
 
-		if (running_non_tiled)
+		// Only WASD has changed since the frame on screen, slide it over instead of recomputing it
+		if (canScroll())
 		{
-			gpu_amp_mandelbrot(((-2.0f * zoom_) + X_Modifier_), ((1.0f *zoom_) + X_Modifier_), ((1.125f * zoom_) + Y_Modifier_), ((-1.125f * zoom_) + Y_Modifier_)); // full set
+			job.pan_x = pan_x;
+			job.pan_y = pan_y;
 		}
-		else if (running_tiled)
+		else if (progressive && cpuMode(computation_mode))
 		{
-			gpu_amp_mandelbrot_tiled(((-2.0f * zoom_) + X_Modifier_), ((1.0f *zoom_) + X_Modifier_), ((1.125f * zoom_) + Y_Modifier_), ((-1.125f * zoom_) + Y_Modifier_)); // full set
+			// Coarse preview first, the finer passes follow as each one is shown
+			job.step = firstProgressiveStep();
 		}
 
-		// Stop timing
-		the_amp_clock::time_point end = the_amp_clock::now();
+		//gpu_amp_mandelbrot(((-0.751085f * zoom_) + X_Modifier_), ((-0.734975f *zoom_) + X_Modifier_), ((0.118378f * zoom_) + Y_Modifier_), ((0.134488f * zoom_) + Y_Modifier_)); // zoomed
 
-		// Compute the difference between the two times in milliseconds
-		auto time_taken = duration_cast<milliseconds>(end - start).count();
+		// Whatever the worker is on now is stale, this replaces it
+		submitFrame(job);
+		pan_x = 0;
+		pan_y = 0;
 
-		mandelbrot_timings_file << "Width: " << "," << WIDTH << endl;
-		mandelbrot_timings_file << "Height: "  << "," << HEIGHT << endl;
-		mandelbrot_timings_file << "Max Iterations: " << "," << MAX_ITERATIONS << endl;
-		mandelbrot_timings_file << "Time taken: " << "," << time_taken << endl;
-		mandelbrot_timings_file << endl; 
+		recalculate = false;
+	}
+	// Refine a progressive frame a pass at a time, each one is shown before the next starts
+	else if (frame_stats[front].job.step > 1 && showingLatest())
+	{
+		RenderJob job = frame_stats[front].job;
+		job.previous_step = job.step;
+		job.step /= 2;
+		job.deadline = the_amp_clock::time_point::max();
+		submitFrame(job);
+	}
+	long long input_ns = profiler.now() - input_start;
+	profiler.record(STAGE_INPUT, input_start, input_ns, frame_number);
+	long long colour_ns = 0;
+	long long upload_ns = 0;
+
+	// New colours change every pixel, new counts only the rectangles the frame marked
+	const FrameBuffer& shown = count_buffers[front];
+	if (recolour && shown.width() > 0)
+	{
+		Tile whole_frame = { 0, 0, shown.width(), shown.height() };
+		dirty_rects.assign(1, whole_frame);
+	}
+	recolour = false;
 
-		//gpu_amp_mandelbrot(((-0.751085f * zoom_) + X_Modifier_), ((-0.734975f *zoom_) + X_Modifier_), ((0.118378f * zoom_) + Y_Modifier_), ((0.134488f * zoom_) + Y_Modifier_)); // zoomed
+	// Either way only the colour pass has to run for the image
+	if (!dirty_rects.empty())
+	{
+		long long start = profiler.now();
+		bool coloured = colourFrame(dirty_rects);
+		long long end = profiler.now();
 
-		recalculate = false;
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, &image);
+		// Nothing to upload until the first frame has been swapped in, or if the buffer couldn't
+		// be mapped (the rectangles stay dirty, and the next frame uploads all of itself)
+		if (coloured)
+		{
+			colour_ns = end - start;
+			colour_time = colour_ns / 1e6;
+			profiler.record(STAGE_COLOUR, start, colour_ns, frame_number);
+
+			// Into the texture allocated for this size, from a pixel buffer where there are any
+			start = profiler.now();
+			texture_stream.upload(dirty_rects);
+			end = profiler.now();
+			upload_ns = end - start;
+			upload_time = upload_ns / 1e6;
+			profiler.record(STAGE_UPLOAD, start, upload_ns, frame_number);
+			dirty_rects.clear();
+		}
+	}
+
+	// A finished frame's row of the timing log, now that it has been coloured and uploaded
+	if (timing_pending)
+	{
+		timing_record.input_ns = input_ns;
+		timing_record.colour_ns = colour_ns;
+		timing_record.upload_ns = upload_ns;
+		timing_log.log(timing_record);
+		timing_pending = false;
 	}
 
 	// Calculate FPS for output
 	calculateFPS();
+	frame_number++;
 } // update
 
 // Resize the window and scene components if user rescales window
@@ -193,198 +288,525 @@ void Mandelbrot2::query_AMP_support()
 } // query_AMP_support
 
 // Generate mandelbrot set on GPU using amp
-void Mandelbrot2::gpu_amp_mandelbrot(float left_, float right_, float top_, float bottom_)
+void Mandelbrot2::gpu_amp_mandelbrot(const RenderJob& job, FrameBuffer& counts)
 {
-	unsigned max_iter = MAX_ITERATIONS;
-	unsigned w = WIDTH;
-	unsigned h = HEIGHT;
-	uint32_t *pImage = &(image[0][0]);
-	unsigned r = red;
-	unsigned g = green;
-	unsigned b = blue;
+	amp_backend.setMaxIterations(job.settings.max_iterations);
+
+	try
+	{
+		amp_backend.gpu_amp_mandelbrot(counts.data(), counts.width(), counts.height(), counts.stride(), job.view);
+	}
+	catch (const std::exception& ex)
+	{
+		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+	}
+} // gpu_amp_mandelbrot
 
-	array_view<uint32_t, 2> a(h, w, pImage);
-	a.discard_data();
+// Generate mandelbrot set on GPU using amp with tiles
+void Mandelbrot2::gpu_amp_mandelbrot_tiled(const RenderJob& job, FrameBuffer& counts)
+{
+	amp_backend.setMaxIterations(job.settings.max_iterations);
 
 	try
 	{
-		parallel_for_each(a.extent, [=](index<2> idx) restrict(amp)
-		{
-			//USE THREAD ID/INDEX TO MAP INTO THE COMPLEX PLANE
-			int x = idx[1];
-			int y = idx[0];
+		amp_backend.gpu_amp_mandelbrot_tiled(counts.data(), counts.width(), counts.height(), counts.stride(), job.view);
+	}
+	catch (const std::exception& ex)
+	{
+		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+	}
+} // gpu_amp_mandelbrot_tiled
 
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
-			Complex1 c = { left_ + (x * (right_ - left_) / w), top_ + (y * (bottom_ - top_) / h) };
+// Pass a frame's settings on to the CPU backend before it computes
+void Mandelbrot2::prepareCpuBackend(const FrameSettings& settings)
+{
+	cpu_backend.setMaxIterations(settings.max_iterations);
+	cpu_backend.setPeriodicityCheck(settings.periodicity_check ? PERIOD_TOLERANCE : 0.0f);
+} // prepareCpuBackend
 
-			// Start off z at (0, 0).
-			Complex1 z = { 0.0, 0.0 };
+// Generate mandelbrot set on the CPU, rows spread across all cores
+void Mandelbrot2::cpu_mandelbrot(const RenderJob& job, FrameBuffer& counts)
+{
+	prepareCpuBackend(job.settings);
+	cpu_backend.cpu_mandelbrot(counts.data(), counts.width(), counts.height(), counts.stride(), job.view);
+} // cpu_mandelbrot
 
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			int iterations = 0;
-			while (c_abs(z) < 2.0 && iterations < max_iter)
-			{
-				z = c_add(c_mul(z, z), c);
+// Generate mandelbrot set on the CPU in work-stealing tiles
+void Mandelbrot2::cpu_mandelbrot_tiled(const RenderJob& job, FrameBuffer& counts)
+{
+	prepareCpuBackend(job.settings);
+	cpu_backend.cpu_mandelbrot_tiled(counts.data(), counts.width(), counts.height(), counts.stride(), job.view);
+} // cpu_mandelbrot_tiled
 
-				++iterations;
-			}
+// Generate mandelbrot set on the CPU, iterating only rectangle borders where possible
+void Mandelbrot2::cpu_mandelbrot_mariani_silver(const RenderJob& job, FrameBuffer& counts)
+{
+	prepareCpuBackend(job.settings);
+	cpu_backend.cpu_mandelbrot_mariani_silver(counts.data(), counts.width(), counts.height(), counts.stride(), job.view);
+} // cpu_mandelbrot_mariani_silver
 
-			if (iterations == max_iter)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				a[y][x] = 0x000000; // black
-			}
-			else
+// Slide a copy of the frame on screen over by the job's pan and compute only the uncovered strips
+void Mandelbrot2::cpu_mandelbrot_scrolled(const RenderJob& job, FrameBuffer& counts)
+{
+	prepareCpuBackend(job.settings);
+	cpu_backend.cpu_mandelbrot_scrolled(counts.data(), counts.width(), counts.height(), counts.stride(), job.pan_x, job.pan_y, job.view);
+} // cpu_mandelbrot_scrolled
+
+// One pass of progressive refinement on the CPU, on top of a copy of the pass on screen
+void Mandelbrot2::cpu_mandelbrot_progressive(const RenderJob& job, FrameBuffer& counts)
+{
+	prepareCpuBackend(job.settings);
+	cpu_backend.cpu_mandelbrot_progressive(counts.data(), counts.width(), counts.height(), counts.stride(), job.step, job.previous_step, job.view);
+} // cpu_mandelbrot_progressive
+
+// Rounds down rather than towards zero, for grid positions left of or above the anchor
+static long long floor_div(long long a, long long b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+} // floor_div
+
+// Copy in the tiles the cache has for this view, compute the rest in one go and keep them
+void Mandelbrot2::cpu_mandelbrot_cached(const RenderJob& job, FrameBuffer& counts, FrameStats& stats)
+{
+	prepareCpuBackend(job.settings);
+	int width = counts.width();
+	int height = counts.height();
+
+	long long origin_x, origin_y;
+	TileKey key;
+	key.grid = tile_cache.grid(job.view, width, height, origin_x, origin_y);
+	key.max_iter = job.settings.max_iterations;
+	key.periodicity_check = job.settings.periodicity_check;
+	// A tile computed in float isn't the same as one computed in double, even on the same grid
+	key.precision = cpu_backend.precisionFor(job.view, width, height);
+	key.series_approximation = cpu_backend.seriesApproximation();
+
+	// Every cache tile the frame overlaps, clipped to the frame. parts are in frame pixels,
+	// and the same rectangles measured from the top-left of their cache tile.
+	std::vector<Tile> missing;
+	std::vector<Tile> missing_parts;
+	std::vector<TileKey> missing_keys;
+	long long first_row = floor_div(origin_y, CACHE_TILE);
+	long long last_row = floor_div(origin_y + height - 1, CACHE_TILE);
+	long long first_column = floor_div(origin_x, CACHE_TILE);
+	long long last_column = floor_div(origin_x + width - 1, CACHE_TILE);
+	for (key.row = first_row; key.row <= last_row; key.row++)
+	{
+		int tile_y = (int)(key.row * CACHE_TILE - origin_y);
+		int y0 = tile_y > 0 ? tile_y : 0;
+		int y1 = tile_y + CACHE_TILE < height ? tile_y + CACHE_TILE : height;
+		for (key.column = first_column; key.column <= last_column; key.column++)
+		{
+			int tile_x = (int)(key.column * CACHE_TILE - origin_x);
+			int x0 = tile_x > 0 ? tile_x : 0;
+			int x1 = tile_x + CACHE_TILE < width ? tile_x + CACHE_TILE : width;
+
+			Tile frame_part = { x0, y0, x1 - x0, y1 - y0 };
+			Tile tile_part = { x0 - tile_x, y0 - tile_y, x1 - x0, y1 - y0 };
+			if (!tile_cache.lookup(key, tile_part, counts.row(y0) + x0, counts.stride()))
 			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				//a[y][x] = 0xFFFFFF; // white
-				a[y][x] = (b * iterations << 16) | (g * iterations << 8) | r * iterations; // grayscale
-				// BGR
+				missing.push_back(frame_part);
+				missing_parts.push_back(tile_part);
+				missing_keys.push_back(key);
 			}
-		});
-		a.synchronize();
+		}
 	}
-	catch (const std::exception& ex)
+	stats.cache_hits = (int)((last_row - first_row + 1) * (last_column - first_column + 1) - (long long)missing.size());
+	stats.cache_misses = (int)missing.size();
+
+	cpu_backend.cpu_mandelbrot_tiles(counts.data(), width, height, counts.stride(), missing, job.view);
+
+	// A cancelled frame's tiles may be half done
+	if (cpu_backend.cancelled())
 	{
-		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+		return;
 	}
-} // gpu_amp_mandelbrot
+	for (size_t i = 0; i < missing.size(); i++)
+	{
+		tile_cache.store(missing_keys[i], missing_parts[i], counts.row(missing[i].y) + missing[i].x, counts.stride());
+	}
+} // cpu_mandelbrot_cached
 
-  // Generate mandelbrot set on GPU using amp with tiles
-void Mandelbrot2::gpu_amp_mandelbrot_tiled(float left_, float right_, float top_, float bottom_)
+// Compute a frame into the back buffer, runs on the worker thread.
+// Only reads the front buffer, which the main thread doesn't swap until this has finished.
+void Mandelbrot2::computeFrame(const RenderJob& job)
 {
-	unsigned max_iter = MAX_ITERATIONS;
-	unsigned w = WIDTH;
-	unsigned h = HEIGHT;
-	uint32_t *pImage = &(image[0][0]);
-	unsigned r = red;
-	unsigned g = green;
-	unsigned b = blue;
-	extent<2> e(h, w);
-	array_view<uint32_t, 2> a(e, pImage);
-	a.discard_data();
+	int back = 1 - front;
+	FrameBuffer& counts = count_buffers[back];
+	FrameStats& stats = frame_stats[back];
+	stats = FrameStats();
+	stats.job = job;
 
+	// Only reallocates when the resolution has changed
 	try
 	{
-		parallel_for_each(a.extent.tile<TS, TS>(), [=](tiled_index<TS,TS> t_idx) restrict(amp)
+		counts.resize(job.settings.width, job.settings.height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		stats.out_of_memory = true;
+		return;
+	}
+
+	// Checked before every row or tile, so a stale frame stops within a tile's time of being replaced
+	cpu_backend.setCancellation([this, &job]
+	{
+		return worker.stale(job.generation) || the_amp_clock::now() > job.deadline;
+	});
+
+	// Start timing
+	the_amp_clock::time_point start = the_amp_clock::now();
+	long long profile_start = profiler.now();
+
+	bool scroll = job.pan_x != 0 || job.pan_y != 0;
+	// Scrolling and later progressive passes carry on from the frame on screen, which has the
+	// same settings (canScroll), so copy it into the back buffer first
+	if (scroll || job.previous_step != 0)
+	{
+		const FrameBuffer& shown = count_buffers[front];
+		for (int y = 0; y < counts.height(); y++)
 		{
-			//USE THREAD ID/INDEX TO MAP INTO THE COMPLEX PLANE
-			index<2> idx = t_idx.global;
-			int x = t_idx.global[1];
-			int y = t_idx.global[0];
-
-			 /*Work out the point in the complex plane that
-			 corresponds to this pixel in the output image.*/
-			Complex1 c = { left_ + (x * (right_ - left_) / w), top_ + (y * (bottom_ - top_) / h) };
-
-			// Start off z at (0, 0).
-			Complex1 z = { 0.0, 0.0 };
-
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			int iterations = 0;
-			while (c_abs(z) < 2.0 && iterations < max_iter)
-			{
-				z = c_add(c_mul(z, z), c);
+			memcpy(counts.row(y), shown.row(y), counts.width() * sizeof(uint32_t));
+		}
+	}
 
-				++iterations;
-			}
+	if (scroll)
+	{
+		cpu_mandelbrot_scrolled(job, counts);
+	}
+	else if (job.step != 0)
+	{
+		cpu_mandelbrot_progressive(job, counts);
+	}
+	else if (job.settings.mode == COMPUTE_AMP_NON_TILED)
+	{
+		gpu_amp_mandelbrot(job, counts); // full set
+	}
+	else if (job.settings.mode == COMPUTE_AMP_TILED)
+	{
+		gpu_amp_mandelbrot_tiled(job, counts); // full set
+		stats.tile_size = amp_backend.tileSize();
+	}
+	else if (job.settings.mode == COMPUTE_CPU)
+	{
+		cpu_mandelbrot(job, counts); // full set
+	}
+	else if (job.settings.mode == COMPUTE_CPU_TILED && job.use_cache)
+	{
+		cpu_mandelbrot_cached(job, counts, stats); // full set, what isn't cached
+		stats.tile_size = CACHE_TILE;
+	}
+	else if (job.settings.mode == COMPUTE_CPU_TILED)
+	{
+		cpu_mandelbrot_tiled(job, counts); // full set
+		stats.tile_size = cpu_backend.tileSize();
+	}
+	else if (job.settings.mode == COMPUTE_MARIANI_SILVER)
+	{
+		cpu_mandelbrot_mariani_silver(job, counts); // full set
+		stats.tile_size = MARIANI_TS;
+	}
 
-			if (iterations == max_iter)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				a[y][x] = 0x000000; // black
-			}
-			else
-			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				//a[y][x] = 0xFFFFFF; // white
-				a[y][x] = (b * iterations << 16) | (g * iterations << 8) | r * iterations; // grayscale
-				// BGR
-			}
-		});
-		a.synchronize();
+	// The texture keeps what a scroll moved, it only needs the strips that were computed
+	if (scroll)
+	{
+		Tile rows, columns;
+		scrolled_strips(counts.width(), counts.height(), job.pan_x, job.pan_y, rows, columns);
+		stats.dirty.push_back(rows);
+		if (columns.width > 0 && columns.height > 0)
+		{
+			stats.dirty.push_back(columns);
+		}
 	}
-	catch (const std::exception& ex)
+	else
 	{
-		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+		Tile whole_frame = { 0, 0, counts.width(), counts.height() };
+		stats.dirty.push_back(whole_frame);
+	}
+
+	// Stop timing
+	the_amp_clock::time_point end = the_amp_clock::now();
+	// The check refers to this job
+	cpu_backend.setCancellation(std::function<bool()>());
+	profiler.record(STAGE_COMPUTE, profile_start, profiler.now() - profile_start, job.generation);
+
+	// Compute the difference between the two times in microseconds
+	stats.time_taken = duration_cast<std::chrono::microseconds>(end - start).count();
+
+	if (cpuMode(job.settings.mode))
+	{
+		stats.cancelled = cpu_backend.cancelled();
+		stats.skipped = cpu_backend.skippedPixels();
+		stats.iterated = cpu_backend.iteratedPixels();
+		stats.periodic = cpu_backend.periodicPixels();
+		stats.iterations_saved = cpu_backend.iterationsSaved();
+		stats.rebased = cpu_backend.rebasedCount();
+		stats.precision = cpu_backend.precision();
+		stats.reference_length = cpu_backend.referenceOrbit().length() - 1;
+		stats.series_skip = cpu_backend.seriesSkip();
+		TileScheduler& scheduler = cpu_backend.tileScheduler();
+		stats.tiles = (int)scheduler.tileTimings().size();
+		stats.steals = scheduler.stealCount();
+		stats.imbalance = scheduler.imbalance();
+	}
+	else
+	{
+		stats.skipped = amp_backend.skippedPixels();
+		stats.precision = PRECISION_FLOAT;
 	}
-} // gpu_amp_mandelbrot_tiled
 
-// Display text within the scene
-void Mandelbrot2::displayText(float x, float y, float r, float g, float b, char * string)
+	long long lookups = tile_cache.hits() + tile_cache.misses();
+	stats.cache_entries = tile_cache.entries();
+	stats.cache_bytes = tile_cache.bytes();
+	stats.cache_hit_rate = lookups > 0 ? (double)tile_cache.hits() / lookups : 0.0;
+} // computeFrame
+
+// Start a job on the worker, one still running goes stale and stops at its next tile
+void Mandelbrot2::submitFrame(const RenderJob& job)
+{
+	worker.submit([this, job](unsigned long long generation)
+	{
+		RenderJob numbered = job;
+		numbered.generation = generation;
+		computeFrame(numbered);
+	});
+} // submitFrame
+
+// Make the frame in the back buffer the one on screen
+void Mandelbrot2::collectFrame()
 {
-	// Get Lenth of string
-	int j = strlen(string);
+	int back = 1 - front;
+	const FrameStats& stats = frame_stats[back];
+	if (stats.out_of_memory)
+	{
+		resolutionTooLarge();
+		return;
+	}
+	// Nothing newer was asked for (or this wouldn't have finished), so it missed its deadline.
+	// Start it again without one, as a preview that refines so something appears soon.
+	if (stats.cancelled)
+	{
+		RenderJob retry = stats.job;
+		retry.deadline = the_amp_clock::time_point::max();
+		if (retry.pan_x == 0 && retry.pan_y == 0)
+		{
+			retry.step = PROGRESSIVE_FIRST_STEP;
+			retry.previous_step = 0;
+		}
+		deadline_misses++;
+		submitFrame(retry);
+		return;
+	}
 
-	// Swap to 2D rendering
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(-1.0, 1.0, -1.0, 1.0, 5, 100);
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	// Orthographic lookAt (along the z-axis).
-	gluLookAt(0.0f, 0.0f, 10.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+	const FrameSettings& settings = stats.job.settings;
+	try
+	{
+		texture_stream.resize(settings.width, settings.height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		resolutionTooLarge();
+		return;
+	}
+	front = back;
 
-	// Set text colour and position.
-	glColor3f(r, g, b);
-	glRasterPos2f(x, y);
-	// Render text.
-	for (int i = 0; i < j; i++) {
-		glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, string[i]);
+	// The passes of a progressive frame are timed together, and logged once the last is done
+	if (stats.job.previous_step == 0)
+	{
+		progressive_time = 0;
+	}
+	progressive_time += stats.time_taken;
+	if (stats.job.step <= 1)
+	{
+		logTiming(stats, progressive_time);
+		if (stats.job.pan_x == 0 && stats.job.pan_y == 0 && cpuMode(settings.mode))
+		{
+			pixel_time = 1000.0 * progressive_time / ((double)settings.width * settings.height);
+		}
 	}
-	// Reset colour to white.
-	glColor3f(1.f, 1.f, 1.f);
 
-	// Swap back to 3D rendering.
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(fov, ((float)window_width / (float)window_height), nearPlane, farPlane);
-	glMatrixMode(GL_MODELVIEW);
-} // displayText
+	// A frame still being refined can't be scrolled
+	last_frame_valid = stats.job.step <= 1;
+
+	// Scroll the texture along with the counts, unless it still has rectangles of the last frame
+	// to upload: they were in that frame's coordinates, so upload all of this one instead
+	bool scrolled = stats.job.pan_x != 0 || stats.job.pan_y != 0;
+	if (scrolled && dirty_rects.empty())
+	{
+		texture_stream.scroll(stats.job.pan_x, stats.job.pan_y);
+		dirty_rects = stats.dirty;
+	}
+	else
+	{
+		Tile whole_frame = { 0, 0, settings.width, settings.height };
+		dirty_rects.assign(1, whole_frame);
+	}
+} // collectFrame
+
+// Fall back to a resolution that will fit, and compute the view again at it
+void Mandelbrot2::resolutionTooLarge()
+{
+	MessageBoxA(NULL, "Not enough memory for this resolution, going back to 640x480", "Error", MB_ICONERROR);
+	WIDTH = 640;
+	HEIGHT = 480;
+	recalculate = true;
+} // resolutionTooLarge
+
+// Turn the iteration counts on screen into the image with the current colours,
+// with the maximum iterations they were computed with
+bool Mandelbrot2::colourFrame(const std::vector<Tile>& rects)
+{
+	const FrameBuffer& counts = count_buffers[front];
+	if (counts.width() == 0 || counts.width() != texture_stream.width() || counts.height() != texture_stream.height())
+	{
+		return false;
+	}
+	// Straight into the memory the texture is uploaded from
+	int stride;
+	uint32_t* image = texture_stream.map(stride);
+	if (image == NULL)
+	{
+		return false;
+	}
+
+	palette.build(frame_stats[front].job.settings.max_iterations, red, green, blue);
+	SimdLevel level = cpu_backend.simdLevel();
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		const Tile& r = rects[i];
+		colour_pool.parallel_for(r.height, [&](int row)
+		{
+			int y = r.y + row;
+			palette_row(level, palette, counts.row(y) + r.x, image + (size_t)y * stride + r.x, r.width);
+		});
+	}
+	return true;
+} // colourFrame
 
 // Render the text to the screen
 void Mandelbrot2::renderTextOutput()
 {
+	long long hud_start = profiler.now();
+	// The same lines in the same order every frame, only the ones whose values changed are formatted again
+	hud.begin();
+
 	// Render current mouse position and frames per second.
-	sprintf_s(mouseText, "Mouse: %i, %i", input->getMouseX(), input->getMouseY());
-	displayText(-1.f, 0.96f, 1.f, 1.f, 1.f, mouseText);
-	displayText(-1.f, 0.90f, 1.f, 1.f, 1.f, fps);
+	hud.print(-1.f, 0.96f, "Mouse: %i, %i", input->getMouseX(), input->getMouseY());
+	hud.print(-1.f, 0.90f, "%s", fps);
 
 	// Render width value
-	sprintf_s(widthText, "Width: %i", WIDTH);
-	displayText(-1.f, 0.84f, 1.f, 1.f, 1.f, widthText);
+	hud.print(-1.f, 0.84f, "Width: %i", WIDTH);
 	// Render height value
-	sprintf_s(heightText, "Height: %i", HEIGHT);
-	displayText(-1.f, 0.78f, 1.f, 1.f, 1.f, heightText);
+	hud.print(-1.f, 0.78f, "Height: %i", HEIGHT);
 
 	// Render max iterations value
-	sprintf_s(iterationText, "Max_Iter: %i", MAX_ITERATIONS);
-	displayText(-1.f, 0.72f, 1.f, 1.f, 1.f, iterationText);
+	hud.print(-1.f, 0.72f, "Max_Iter: %i", MAX_ITERATIONS);
 
 	// Render zoom value
-	sprintf_s(zoomText, "Zoom: %f", zoom_);
-	displayText(-1.f, 0.66f, 1.f, 1.f, 1.f, zoomText);
+	hud.print(-1.f, 0.66f, "Zoom: %g", zoom_);
 
 	// Render blue value
-	sprintf_s(blueText, "Blue: %i", blue);
-	displayText(-1.f, 0.60f, 1.f, 1.f, 1.f, blueText);
+	hud.print(-1.f, 0.60f, "Blue: %i", blue);
 	// Render green value
-	sprintf_s(greenText, "Green: %i", green);
-	displayText(-1.f, 0.54f, 1.f, 1.f, 1.f, greenText);
+	hud.print(-1.f, 0.54f, "Green: %i", green);
 	// Render red value
-	sprintf_s(redText, "Red: %i", red);
-	displayText(-1.f, 0.48f, 1.f, 1.f, 1.f, redText);
+	hud.print(-1.f, 0.48f, "Red: %i", red);
 
 	// Render computation mode setting
-	sprintf_s(computationText, "Mode: %s", computationModeName.c_str());
-	displayText(-1.f, 0.42f, 1.f, 1.f, 1.f, computationText);
+	hud.print(-1.f, 0.42f, "Mode: %s", computationModeName.c_str());
+
+	// Statistics of the frame on screen, which may be behind the settings above while the next computes
+	const FrameStats& shown = frame_stats[front];
+	const FrameSettings& settings = shown.job.settings;
+	int pixels = settings.width * settings.height > 0 ? settings.width * settings.height : 1;
+
+	// Render how many pixels the cardioid/bulb test skipped
+	hud.print(-1.f, 0.36f, "Skipped: %lld (%.1f%%)", shown.skipped, 100.0 * shown.skipped / pixels);
+
+	// Render how evenly the tiles were spread over the workers
+	bool whole_frame = shown.job.pan_x == 0 && shown.job.pan_y == 0 && shown.job.step == 0;
+	// Render how much of the frame came out of the tile cache
+	if (settings.mode == COMPUTE_CPU_TILED && shown.job.use_cache && whole_frame)
+	{
+		int tiles = shown.cache_hits + shown.cache_misses > 0 ? shown.cache_hits + shown.cache_misses : 1;
+		hud.print(-1.f, 0.30f, "Cache: %i/%i tiles (%.0f%%) Held: %u MB Hit rate: %.0f%%", shown.cache_hits, tiles, 100.0 * shown.cache_hits / tiles,
+			(unsigned)(shown.cache_bytes / (1024 * 1024)), 100.0 * shown.cache_hit_rate);
+	}
+	else if (settings.mode == COMPUTE_CPU_TILED)
+	{
+		hud.print(-1.f, 0.30f, "Tiles: %i Steals: %u Imbalance: %.2f", shown.tiles, shown.steals, shown.imbalance);
+	}
+
+	// Render what cycle detection saved on the CPU
+	if (cpuMode(settings.mode))
+	{
+		if (settings.periodicity_check)
+		{
+			hud.print(-1.f, 0.24f, "Periodic: %lld Saved: %lld iter", shown.periodic, shown.iterations_saved);
+		}
+		else
+		{
+			hud.print(-1.f, 0.24f, "Periodic: off");
+		}
+
+		// Render which number type the zoom level needed
+		if (shown.precision == PRECISION_PERTURBATION)
+		{
+			hud.print(-1.f, 0.18f, "Precision: %s Ref: %u iter Series skip: %u Rebased: %lld", precision_name(shown.precision), shown.reference_length, shown.series_skip, shown.rebased);
+		}
+		else
+		{
+			hud.print(-1.f, 0.18f, "Precision: %s", precision_name(shown.precision));
+		}
+	}
+
+	// Render how much of the frame a pan had to compute
+	if (shown.job.pan_x != 0 || shown.job.pan_y != 0)
+	{
+		hud.print(-1.f, 0.12f, "Scrolled: computed %lld of %i (%.1f%%)", shown.iterated, pixels, 100.0 * shown.iterated / pixels);
+	}
+	// Render how many pixels subdivision actually had to iterate
+	else if (settings.mode == COMPUTE_MARIANI_SILVER && whole_frame)
+	{
+		hud.print(-1.f, 0.30f, "Iterated: %lld of %i (%.1f%%)", shown.iterated, pixels, 100.0 * shown.iterated / pixels);
+	}
+
+	// Render how long the last colour pass took, all a colour change costs
+	hud.print(-1.f, 0.06f, "Colour pass: %.2f ms", colour_time);
+
+	// Render how the image reaches the texture, how long the render thread spent on it and how
+	// much of the frame it had to copy
+	double frame_bytes = 4.0 * texture_stream.width() * texture_stream.height();
+	hud.print(-1.f, -0.12f, "Upload: %s %.2f ms %.1f KB (%.1f%% of frame) Total: %.1f MB", upload_path_name(texture_stream.path()), upload_time,
+		texture_stream.uploadedBytes() / 1024.0, frame_bytes > 0 ? 100.0 * texture_stream.uploadedBytes() / frame_bytes : 0.0, texture_stream.totalBytes() / (1024.0 * 1024.0));
+
+	// Render which pass progressive refinement is on
+	if (!progressive)
+	{
+		hud.print(-1.f, 0.0f, "Progressive: off");
+	}
+	else if (shown.job.step > 1)
+	{
+		hud.print(-1.f, 0.0f, "Progressive: 1/%i resolution, refining", shown.job.step);
+	}
+	else
+	{
+		hud.print(-1.f, 0.0f, "Progressive: full resolution");
+	}
+
+	// Render whether a frame is computing behind the one on screen
+	hud.print(-1.f, -0.06f, "Worker: %s Dropped: %llu Missed deadline: %u", worker.busy() ? "computing" : "idle", worker.droppedCount(), deadline_misses);
+
+	// Render the typical and worst frames of each stage, over the last few seconds
+	profiler.refresh();
+	hud.print(-1.f, -0.18f, "p50/p99 ms: input %.2f/%.2f compute %.1f/%.1f colour %.2f/%.2f upload %.2f/%.2f HUD %.2f/%.2f",
+		profiler.p50(STAGE_INPUT), profiler.p99(STAGE_INPUT), profiler.p50(STAGE_COMPUTE), profiler.p99(STAGE_COMPUTE),
+		profiler.p50(STAGE_COLOUR), profiler.p99(STAGE_COLOUR), profiler.p50(STAGE_UPLOAD), profiler.p99(STAGE_UPLOAD),
+		profiler.p50(STAGE_HUD), profiler.p99(STAGE_HUD));
+
+	// Every line in one draw call
+	hud.draw(window_width, window_height);
+	profiler.record(STAGE_HUD, hud_start, profiler.now() - hud_start, frame_number);
 } // renderTextOutput
 
 // Calculate FPS
@@ -406,14 +828,33 @@ void Mandelbrot2::initVariables()
 	MAX_ITERATIONS = 500; // 500 - starter, 10000 - beautiful
 	iteration_modifier_ = MAX_ITERATIONS;
 	recalculate = true;
-	running_non_tiled = true;
-	running_tiled = false;
+	recolour = false;
+	colour_time = 0.0;
+	upload_time = 0.0;
+	progressive = false;
+	progressive_time = 0;
+	pixel_time = 0.0;
+	tile_cache_on = true;
+	deadline_misses = 0;
+	computation_mode = COMPUTE_AMP_NON_TILED;
+	periodicity_check = false;
 	computationModeName = "Non-tiled";
-	X_Modifier_ = 0;
-	Y_Modifier_ = 0;
-	zoom_ = 1.0f;
+	X_Modifier_ = 0.0;
+	Y_Modifier_ = 0.0;
+	zoom_level = 0;
+	zoom_ = 1.0;
 	movement_modifier_ = 0.005f;
-	mandelbrot_timings_file.open("amp_mandelbrot_timings.csv");
+	pan_x = 0;
+	pan_y = 0;
+	last_frame_valid = false;
+	quad_buffer = 0;
+	fps[0] = '\0';
+	frame_number = 0;
+	front = 0;
+	frame_stats[0] = FrameStats();
+	frame_stats[1] = FrameStats();
+	timing_pending = false;
+	timing_log.open("amp_mandelbrot_timings.csv");
 	red = 1;
 	green = 1;
 	blue = 1;
@@ -426,70 +867,62 @@ void Mandelbrot2::initTexture()
 	glBindTexture(GL_TEXTURE_2D, mandelbrotTexture);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// The image wraps round the texture from an origin a pan moves (TextureStreamer::scroll)
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// The texture is allocated as each new size of frame arrives, and filled through the streamer
+	texture_stream.init(mandelbrotTexture);
 } // initTexture
 
-// Record the time it takes to compute the mandelbrot set without tiling
-void Mandelbrot2::timeNonTiled()
-{
-	for (int i = 0; i < 1001; i++)
-	{
-		// Start timing
-		the_amp_clock::time_point start = the_amp_clock::now();
-
-		gpu_amp_mandelbrot(((-2.0f * zoom_) + X_Modifier_), ((1.0f *zoom_) + X_Modifier_), ((1.125f * zoom_) + Y_Modifier_), ((-1.125f * zoom_) + Y_Modifier_)); // full set
-
-																																									   // Stop timing
-		the_amp_clock::time_point end = the_amp_clock::now();
-
-		// Compute the difference between the two times in milliseconds
-		auto time_taken = duration_cast<milliseconds>(end - start).count();
-
-		mandelbrot_timings_file << "Time taken: " << "," << time_taken << endl;
-	}
-} // timeNonTiled
-
-  // Record the time it takes to compute the mandelbrot set with tiling
-void Mandelbrot2::timeTiled()
+// Create the buffer the quad is drawn from and the atlas the HUD's font is drawn from
+void Mandelbrot2::initGeometry()
 {
-	for (int i = 0; i < 1001; i++)
+	load_gl_functions(gl);
+	if (gl.genBuffers && gl.bindBuffer && gl.bufferData)
 	{
-		// Start timing
-		the_amp_clock::time_point start = the_amp_clock::now();
-
-		gpu_amp_mandelbrot_tiled(((-2.0f * zoom_) + X_Modifier_), ((1.0f *zoom_) + X_Modifier_), ((1.125f * zoom_) + Y_Modifier_), ((-1.125f * zoom_) + Y_Modifier_)); // full set
-		
-		// Stop timing
-		the_amp_clock::time_point end = the_amp_clock::now();
-
-		// Compute the difference between the two times in milliseconds
-		auto time_taken = duration_cast<milliseconds>(end - start).count();
-
-		mandelbrot_timings_file << "Time taken: " << "," << time_taken << endl;
+		gl.genBuffers(1, &quad_buffer);
+		gl.bindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+		gl.bufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
+		gl.bindBuffer(GL_ARRAY_BUFFER, 0);
 	}
-} // timeTiled
+	hud.init(gl, GLUT_BITMAP_HELVETICA_12);
+} // initGeometry
 
-// Generate a 2x2 quad and scale it to the window size
+// Draw the 2x2 quad scaled to the window size, from its vertex buffer (or client memory without one)
 void Mandelbrot2::generateQuad()
 {
 	glPushMatrix();
 
 	glScalef(2.5f, 2.48f, 0.0f);
 
-	glBegin(GL_QUADS);
-
-	glTexCoord2f(1.0f, 1.0f);
-	glVertex3f(1.0f, -1.0f, 0.0f); // bottom right
-
-	glTexCoord2f(1.0f, 0.0f);
-	glVertex3f(1.0f, 1.0f, 0.0f); // top right
-
-	glTexCoord2f(0.0f, 0.0f);
-	glVertex3f(-1.0f, 1.0f, 0.0f); // top left
+	// The image starts at the streamer's origin and wraps round the texture
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glTranslatef(texture_stream.originU(), texture_stream.originV(), 0.0f);
+	glMatrixMode(GL_MODELVIEW);
+	glBindTexture(GL_TEXTURE_2D, mandelbrotTexture);
 
-	glTexCoord2f(0.0f, 1.0f);
-	glVertex3f(-1.0f, -1.0f, 0.0f); // bottom left
+	const char* base = (const char*)quad_vertices;
+	if (quad_buffer != 0)
+	{
+		gl.bindBuffer(GL_ARRAY_BUFFER, quad_buffer);
+		base = NULL;
+	}
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(QuadVertex), base + offsetof(QuadVertex, x));
+	glTexCoordPointer(2, GL_FLOAT, sizeof(QuadVertex), base + offsetof(QuadVertex, u));
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (quad_buffer != 0)
+	{
+		gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
 
-	glEnd();
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
 
 	glPopMatrix();
 } // generateQuad
@@ -500,7 +933,7 @@ void Mandelbrot2::setWidth_Height()
 	// 640x480
 	if (input->isKeyDown('1'))
 	{
-		if (WIDTH != 640 && HEIGHT != 480)
+		if (WIDTH != 640 || HEIGHT != 480)
 		{
 			WIDTH = 640;
 			HEIGHT = 480;
@@ -511,7 +944,7 @@ void Mandelbrot2::setWidth_Height()
 	// 960x768
 	if (input->isKeyDown('2'))
 	{
-		if (WIDTH != 960 && HEIGHT != 768)
+		if (WIDTH != 960 || HEIGHT != 768)
 		{
 			WIDTH = 960;
 			HEIGHT = 768;
@@ -522,7 +955,7 @@ void Mandelbrot2::setWidth_Height()
 	// 1280x960
 	if (input->isKeyDown('3'))
 	{
-		if (WIDTH != 1280 && HEIGHT != 960)
+		if (WIDTH != 1280 || HEIGHT != 960)
 		{
 			WIDTH = 1280;
 			HEIGHT = 960;
@@ -533,7 +966,7 @@ void Mandelbrot2::setWidth_Height()
 	// 1920x1280
 	if (input->isKeyDown('4'))
 	{
-		if (WIDTH != 1920 && HEIGHT != 1280)
+		if (WIDTH != 1920 || HEIGHT != 1280)
 		{
 			WIDTH = 1920;
 			HEIGHT = 1280;
@@ -541,6 +974,39 @@ void Mandelbrot2::setWidth_Height()
 		}
 		input->SetKeyUp('4');
 	}
+	// 3840x2160 (4K)
+	if (input->isKeyDown('5'))
+	{
+		if (WIDTH != 3840 || HEIGHT != 2160)
+		{
+			WIDTH = 3840;
+			HEIGHT = 2160;
+			recalculate = true;
+		}
+		input->SetKeyUp('5');
+	}
+	// 7680x4320 (8K)
+	if (input->isKeyDown('6'))
+	{
+		if (WIDTH != 7680 || HEIGHT != 4320)
+		{
+			WIDTH = 7680;
+			HEIGHT = 4320;
+			recalculate = true;
+		}
+		input->SetKeyUp('6');
+	}
+	// Whatever size the window currently is
+	if (input->isKeyDown('0'))
+	{
+		if ((WIDTH != window_width || HEIGHT != window_height) && window_width > 0 && window_height > 0)
+		{
+			WIDTH = window_width;
+			HEIGHT = window_height;
+			recalculate = true;
+		}
+		input->SetKeyUp('0');
+	}
 } // setResolution
 
 // Set the movement modifier to be smaller/larger depending on zoom level
@@ -559,19 +1025,30 @@ void Mandelbrot2::alterMovementModifierByZoomLevel()
 	{
 		movement_modifier_ = 0.00005f;
 	}
+	// Past here keep each step a fixed fraction of the view, however deep it goes
 	if (zoom_ < 0.00005f)
 	{
-		movement_modifier_ = 0.000005f;
+		movement_modifier_ = zoom_ / 10;
 	}
 } // alterMovementModifierByZoomLevel
 
 // Detect key presses by user to move around the mandelbrot set and recalculate upon moving
 void Mandelbrot2::userMovement()
 {
+	// Size of a pixel on the plane, each move is rounded to whole pixels (at least one)
+	// so the last frame lines up with the new one and can be scrolled
+	double pixel_x = 3.0 * zoom_ / WIDTH;
+	double pixel_y = 2.25 * zoom_ / HEIGHT;
+	int steps_x = (int)(movement_modifier_ / pixel_x + 0.5);
+	int steps_y = (int)(movement_modifier_ / pixel_y + 0.5);
+	steps_x = steps_x < 1 ? 1 : steps_x;
+	steps_y = steps_y < 1 ? 1 : steps_y;
+
 	// move left
 	if (input->isKeyDown('a') || input->isKeyDown('A'))
 	{
-		X_Modifier_ -= movement_modifier_;
+		X_Modifier_ -= steps_x * pixel_x;
+		pan_x -= steps_x;
 
 		recalculate = true;
 		input->SetKeyUp('a');
@@ -580,7 +1057,8 @@ void Mandelbrot2::userMovement()
 	// move right
 	if (input->isKeyDown('d') || input->isKeyDown('D'))
 	{
-		X_Modifier_ += movement_modifier_;
+		X_Modifier_ += steps_x * pixel_x;
+		pan_x += steps_x;
 		recalculate = true;
 		input->SetKeyUp('d');
 		input->SetKeyUp('D');
@@ -588,7 +1066,8 @@ void Mandelbrot2::userMovement()
 	// move up
 	if (input->isKeyDown('w') || input->isKeyDown('W'))
 	{
-		Y_Modifier_ += movement_modifier_;
+		Y_Modifier_ += steps_y * pixel_y;
+		pan_y -= steps_y;
 		recalculate = true;
 		input->SetKeyUp('w');
 		input->SetKeyUp('W');
@@ -596,7 +1075,8 @@ void Mandelbrot2::userMovement()
 	// move down
 	if (input->isKeyDown('s') || input->isKeyDown('S'))
 	{
-		Y_Modifier_ -= movement_modifier_;
+		Y_Modifier_ -= steps_y * pixel_y;
+		pan_y += steps_y;
 		recalculate = true;
 		input->SetKeyUp('s');
 		input->SetKeyUp('S');
@@ -609,7 +1089,8 @@ void Mandelbrot2::userZoom()
 	// zoom in
 	if (input->isKeyDown('r') || input->isKeyDown('R'))
 	{
-		zoom_ -= (zoom_ / 10);
+		zoom_level++;
+		zoom_ = std::pow(0.9, zoom_level);
 		recalculate = true;
 		input->SetKeyUp('r');
 		input->SetKeyUp('R');
@@ -617,7 +1098,8 @@ void Mandelbrot2::userZoom()
 	// zoom out
 	if (input->isKeyDown('f') || input->isKeyDown('F'))
 	{
-		zoom_ += (zoom_ / 10);
+		zoom_level--;
+		zoom_ = std::pow(0.9, zoom_level);
 		recalculate = true;
 		input->SetKeyUp('f');
 		input->isKeyDown('F');
@@ -660,7 +1142,7 @@ void Mandelbrot2::setColour()
 		if (blue < 255)
 		{
 			blue++;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('t');
 		input->SetKeyUp('T');
@@ -671,7 +1153,7 @@ void Mandelbrot2::setColour()
 		if (blue > 1)
 		{
 			blue--;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('g');
 		input->SetKeyUp('G');
@@ -683,7 +1165,7 @@ void Mandelbrot2::setColour()
 		if (green < 255)
 		{
 			green++;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('y');
 		input->SetKeyUp('Y');
@@ -694,7 +1176,7 @@ void Mandelbrot2::setColour()
 		if (green > 1)
 		{
 			green--;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('h');
 		input->SetKeyUp('H');
@@ -706,7 +1188,7 @@ void Mandelbrot2::setColour()
 		if (red < 255)
 		{
 			red++;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('u');
 		input->SetKeyUp('U');
@@ -717,34 +1199,183 @@ void Mandelbrot2::setColour()
 		if (red > 1)
 		{
 			red--;
-			recalculate = true;
+			recolour = true;
 		}
 		input->SetKeyUp('j');
 		input->SetKeyUp('J');
 	}
 } // setColour
 
-// Detect key presses to set whether the tiled or non-tiled computation is run
+// Detect key presses to set which computation is run
 void Mandelbrot2::setComputation()
 {
 	// run non tiled computation
 	if (input->isKeyDown('z') || input->isKeyDown('Z'))
 	{
-		computationModeName = "Non-tiled";
-		running_non_tiled = true;
-		running_tiled = false;
-		recalculate = true;
+		selectComputation(COMPUTE_AMP_NON_TILED, "Non-tiled");
 		input->SetKeyUp('z');
 		input->SetKeyUp('Z');
 	}
 	// run tiled computation
 	if (input->isKeyDown('x') || input->isKeyDown('X'))
 	{
-		computationModeName = "Tiled";
-		running_tiled = true;
-		running_non_tiled = false;
-		recalculate = true;
+		selectComputation(COMPUTE_AMP_TILED, "Tiled");
 		input->SetKeyUp('x');
-		input->SetKeyUp('Z');
+		input->SetKeyUp('X');
+	}
+	// run computation on the CPU thread pool
+	if (input->isKeyDown('c') || input->isKeyDown('C'))
+	{
+		selectComputation(COMPUTE_CPU, std::string("CPU ") + simd_level_name(cpu_backend.simdLevel()));
+		input->SetKeyUp('c');
+		input->SetKeyUp('C');
 	}
-} // setComputation
\ No newline at end of file
+	// run computation on the CPU in work-stealing tiles
+	if (input->isKeyDown('v') || input->isKeyDown('V'))
+	{
+		selectComputation(COMPUTE_CPU_TILED, std::string("CPU Tiled ") + simd_level_name(cpu_backend.simdLevel()));
+		input->SetKeyUp('v');
+		input->SetKeyUp('V');
+	}
+	// toggle cycle detection in the CPU kernels
+	if (input->isKeyDown('p') || input->isKeyDown('P'))
+	{
+		periodicity_check = !periodicity_check;
+		recalculate = true;
+		input->SetKeyUp('p');
+		input->SetKeyUp('P');
+	}
+	// run Mariani-Silver subdivision on the CPU
+	if (input->isKeyDown('b') || input->isKeyDown('B'))
+	{
+		selectComputation(COMPUTE_MARIANI_SILVER, "Mariani-Silver");
+		input->SetKeyUp('b');
+		input->SetKeyUp('B');
+	}
+	// toggle the tile cache in the CPU Tiled mode
+	if (input->isKeyDown('k') || input->isKeyDown('K'))
+	{
+		tile_cache_on = !tile_cache_on;
+		recalculate = true;
+		input->SetKeyUp('k');
+		input->SetKeyUp('K');
+	}
+	// toggle progressive refinement in the CPU modes
+	if (input->isKeyDown('o') || input->isKeyDown('O'))
+	{
+		progressive = !progressive;
+		recalculate = true;
+		input->SetKeyUp('o');
+		input->SetKeyUp('O');
+	}
+} // setComputation
+
+// Write the frame profile to a Chrome trace when L is pressed
+void Mandelbrot2::writeTrace()
+{
+	if (input->isKeyDown('l') || input->isKeyDown('L'))
+	{
+		int events = profiler.writeTrace("frame_trace.json");
+		if (events < 0)
+		{
+			MessageBoxA(NULL, "Couldn't write frame_trace.json", "Error", MB_ICONERROR);
+		}
+		else
+		{
+			cout << "Wrote " << events << " events to frame_trace.json" << endl;
+		}
+		input->SetKeyUp('l');
+		input->SetKeyUp('L');
+	}
+} // writeTrace
+
+// Gather the settings the next frame will be computed with
+FrameSettings Mandelbrot2::currentFrameSettings() const
+{
+	FrameSettings settings;
+	settings.width = WIDTH;
+	settings.height = HEIGHT;
+	settings.max_iterations = MAX_ITERATIONS;
+	settings.zoom = zoom_;
+	settings.mode = computation_mode;
+	settings.periodicity_check = periodicity_check;
+	settings.precision = cpu_backend.precisionFor(make_viewport(X_Modifier_, Y_Modifier_, zoom_), WIDTH, HEIGHT);
+	return settings;
+} // currentFrameSettings
+
+// Whether a mode computes on the CPU backend
+bool Mandelbrot2::cpuMode(ComputationMode mode)
+{
+	return mode == COMPUTE_CPU || mode == COMPUTE_CPU_TILED || mode == COMPUTE_MARIANI_SILVER;
+} // cpuMode
+
+// An idle worker isn't enough: a frame that finished after this loop's finished() check hasn't
+// been collected yet, and the one on screen is older than it
+bool Mandelbrot2::showingLatest() const
+{
+	return frame_stats[front].job.generation == worker.generation();
+} // showingLatest
+
+// Only the CPU modes can compute part of a frame, and only a pan with nothing else changed can reuse one.
+// The pan is from the last frame asked for, so that has to be the one on screen.
+bool Mandelbrot2::canScroll() const
+{
+	return cpuMode(computation_mode) && (pan_x != 0 || pan_y != 0) && last_frame_valid && showingLatest()
+		&& frame_stats[front].job.settings == currentFrameSettings();
+} // canScroll
+
+// Smallest step whose pass should fit in PROGRESSIVE_BUDGET_MS going by the last full CPU frame,
+// PROGRESSIVE_FIRST_STEP if nothing has been timed yet
+int Mandelbrot2::firstProgressiveStep() const
+{
+	int step = 1;
+	while (step < PROGRESSIVE_FIRST_STEP && (pixel_time <= 0.0 || pixel_time * WIDTH * HEIGHT / (step * step) > PROGRESSIVE_BUDGET_MS * 1e6))
+	{
+		step *= 2;
+	}
+	return step;
+} // firstProgressiveStep
+
+// Save one computation's timing to the .CSV file
+void Mandelbrot2::logTiming(const FrameStats& stats, long long time_taken)
+{
+	const FrameSettings& settings = stats.job.settings;
+	timing_record.timestamp_ms = duration_cast<milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	timing_record.width = settings.width;
+	timing_record.height = settings.height;
+	timing_record.max_iterations = settings.max_iterations;
+	timing_record.backend = backendName(settings.mode);
+	timing_record.tile_size = stats.tile_size;
+	timing_record.compute_ns = time_taken * 1000;
+	// The render thread's stages are filled in by update() once they have run
+	timing_record.input_ns = 0;
+	timing_record.colour_ns = 0;
+	timing_record.upload_ns = 0;
+	timing_pending = true;
+} // logTiming
+
+// Same names as the batch renderer's --backend, for the timing log
+const char* Mandelbrot2::backendName(ComputationMode mode)
+{
+	switch (mode)
+	{
+	case COMPUTE_AMP_NON_TILED:
+		return "amp";
+	case COMPUTE_AMP_TILED:
+		return "amp-tiled";
+	case COMPUTE_CPU:
+		return "cpu";
+	case COMPUTE_CPU_TILED:
+		return "cpu-tiled";
+	default:
+		return "mariani-silver";
+	}
+} // backendName
+
+// Switch computation and force a recalculation with it
+void Mandelbrot2::selectComputation(ComputationMode mode, const std::string& name)
+{
+	computation_mode = mode;
+	computationModeName = name;
+	recalculate = true;
+} // selectComputation
@@ -2,15 +2,110 @@
 
 // Include GLUT, openGL, input.
 #include "Includes.h"
+#include "AmpMandelbrot.h"
+#include "CpuMandelbrot.h"
+#include "FrameBuffer.h"
+#include "FrameProfiler.h"
+#include "GLFunctions.h"
+#include "HudText.h"
+#include "RenderWorker.h"
+#include "TextureStreamer.h"
+#include "TileCache.h"
+#include "TimingLog.h"
 
-// define a tile size
-// max threads 1024 per tile
-// max tiles 65536 in any dimension
-// 32 = MAX
-#define TS 4
-//#define TS 8
-//#define TS 16
-//#define TS 32
+// How close (in each of x and y) an orbit has to come back to an earlier point to count
+// as a cycle. A few float ulps at |z| ~ 1, large enough to catch slowly converging cycles
+#define PERIOD_TOLERANCE 1e-6f
+
+// Progressive refinement starts at 1/PROGRESSIVE_FIRST_STEP resolution at most, or finer if the
+// last frame says a finer first pass still fits in PROGRESSIVE_BUDGET_MS
+#define PROGRESSIVE_FIRST_STEP 8
+#define PROGRESSIVE_BUDGET_MS 16
+
+// Milliseconds a CPU frame asked for while the one before it was still computing (the user is
+// changing the view faster than frames finish, e.g. holding R) may take. One that runs over is
+// stopped and done again progressively, so a preview appears instead of a long wait.
+#define FRAME_DEADLINE_MS 100
+
+// Computations the user can switch between with setComputation
+enum ComputationMode
+{
+	COMPUTE_AMP_NON_TILED,
+	COMPUTE_AMP_TILED,
+	COMPUTE_CPU,
+	COMPUTE_CPU_TILED,
+	COMPUTE_MARIANI_SILVER
+};
+
+// Everything besides the centre that decides a frame's iteration counts.
+// A pan can only reuse the last frame if none of it has changed since.
+struct FrameSettings
+{
+	int width, height;
+	int max_iterations;
+	double zoom;
+	ComputationMode mode;
+	bool periodicity_check;
+	// The number type the view resolves to, never PRECISION_AUTO. Can change with the centre
+	// alone, a frame kept from one precision doesn't line up with strips computed in another.
+	Precision precision;
+};
+
+inline bool operator==(const FrameSettings& a, const FrameSettings& b)
+{
+	return a.width == b.width && a.height == b.height && a.max_iterations == b.max_iterations
+		&& a.zoom == b.zoom && a.mode == b.mode && a.periodicity_check == b.periodicity_check
+		&& a.precision == b.precision;
+} // operator==
+
+// RenderJob struct
+// Everything a frame is computed from, copied into the job so the main thread can carry on
+// changing its own settings while the worker computes it.
+struct RenderJob
+{
+	Viewport view;
+	FrameSettings settings;
+	// Pan since the frame on screen, when the job scrolls it rather than computing a new one
+	int pan_x, pan_y;
+	// Progressive pass to run and the one before it (cpu_mandelbrot_progressive), 0 for a whole frame
+	int step, previous_step;
+	// Number the worker gave the job, a newer one makes it stale (RenderWorker)
+	unsigned long long generation;
+	// Whether a CPU Tiled frame takes the tiles it can from tile_cache
+	bool use_cache;
+	// When the CPU kernels give up on it, the_amp_clock::time_point::max() for never.
+	// The AMP kernels can't be stopped part way through a dispatch, so they don't have one.
+	the_amp_clock::time_point deadline;
+};
+
+// FrameStats struct
+// What the HUD and timing log show about a computed frame. Taken by the worker as the frame
+// finishes, so the main thread never reads a backend that is busy with the next one.
+struct FrameStats
+{
+	RenderJob job;
+	// The count buffer couldn't be allocated, nothing was computed
+	bool out_of_memory;
+	// Stopped part way through, by its deadline or a newer job
+	bool cancelled;
+	// Microseconds the worker spent on the frame
+	long long time_taken;
+	long long skipped, iterated, periodic, iterations_saved, rebased;
+	Precision precision;
+	unsigned reference_length, series_skip;
+	int tiles;
+	unsigned steals;
+	float imbalance;
+	// Tiles of the frame found in and missing from the tile cache, and the cache's state after it
+	int cache_hits, cache_misses;
+	size_t cache_entries, cache_bytes;
+	double cache_hit_rate;
+	// Edge of the tiles the kernel split the frame into, 0 if it didn't (TimingRecord)
+	int tile_size;
+	// Rectangles of the image that differ from the frame before: the strips a scrolled frame
+	// computed (the rest moved with the pan), the whole frame for anything else
+	std::vector<Tile> dirty;
+};
 
 class Mandelbrot2
 {
@@ -30,23 +125,32 @@ public:
 
 	void query_AMP_support();
 
-	void gpu_amp_mandelbrot(float left_, float right_, float top_, float bottom_);
+	void gpu_amp_mandelbrot(const RenderJob& job, FrameBuffer& counts);
+
+	void gpu_amp_mandelbrot_tiled(const RenderJob& job, FrameBuffer& counts);
+
+	void cpu_mandelbrot(const RenderJob& job, FrameBuffer& counts);
+
+	void cpu_mandelbrot_tiled(const RenderJob& job, FrameBuffer& counts);
 
-	void gpu_amp_mandelbrot_tiled(float left_, float right_, float top_, float bottom_);
+	void cpu_mandelbrot_mariani_silver(const RenderJob& job, FrameBuffer& counts);
+
+	void cpu_mandelbrot_scrolled(const RenderJob& job, FrameBuffer& counts);
+
+	void cpu_mandelbrot_progressive(const RenderJob& job, FrameBuffer& counts);
+
+	void cpu_mandelbrot_cached(const RenderJob& job, FrameBuffer& counts, FrameStats& stats);
 
 protected:
-	// Renders text (x, y positions, RGB colour of text, string of text to be rendered)
-	void displayText(float x, float y, float r, float g, float b, char* string);
-	// A function to collate all text output in a single location
+	// A function to collate all text output in a single location, drawn in one batch by hud
 	void renderTextOutput();
 	void calculateFPS();
 	// Initialise variables and texture
 	void initVariables();
 	void initTexture();
-	// functions to time the mandelbrot set at various settings
-	void timeNonTiled();
-	void timeTiled();
-	// Generates a 2x2 quad and scales to window size
+	// Creates the quad's vertex buffer and the HUD's glyph atlas
+	void initGeometry();
+	// Draws a 2x2 quad scaled to window size
 	void generateQuad();
 	// Sets WIDTH/HEIGHT based on user key presses
 	void setWidth_Height();
@@ -62,6 +166,39 @@ protected:
 	void setColour();
 	// Allows the user to choose what computation to run
 	void setComputation();
+	// Writes the frame profile out as a Chrome trace when the user asks for it
+	void writeTrace();
+	// Passes a frame's iteration and cycle detection settings on to the CPU backend
+	void prepareCpuBackend(const FrameSettings& settings);
+	// Computes a job into the back count buffer and fills in its statistics, on the worker thread
+	void computeFrame(const RenderJob& job);
+	// Hands a job to the worker, replacing any that hasn't started yet
+	void submitFrame(const RenderJob& job);
+	// Swaps in the frame the worker has just finished, once it has checked it is usable
+	void collectFrame();
+	// Tells the user a resolution didn't fit in memory and goes back to 640x480
+	void resolutionTooLarge();
+	// Colours rectangles of the count buffer on screen into the texture streamer's next buffer,
+	// false if there is no frame to colour
+	bool colourFrame(const std::vector<Tile>& rects);
+	// Switches to a computation mode and recalculates with it
+	void selectComputation(ComputationMode mode, const std::string& name);
+	// The settings the next frame will be computed with
+	FrameSettings currentFrameSettings() const;
+	// Whether a computation mode runs on cpu_backend
+	static bool cpuMode(ComputationMode mode);
+	// Whether the frame on screen is the result of the last job submitted, so a pan or the next
+	// progressive pass can start from it
+	bool showingLatest() const;
+	// Whether the next frame can be made by scrolling the one on screen by pan_x, pan_y
+	bool canScroll() const;
+	// Step of the first pass of a progressive frame
+	int firstProgressiveStep() const;
+	// Starts the timing log row of a frame that took time_taken microseconds to compute,
+	// update() queues it on timing_log once the frame has been coloured and uploaded
+	void logTiming(const FrameStats& stats, long long time_taken);
+	// Name of a computation mode in the timing log
+	static const char* backendName(ComputationMode mode);
 
 	// The number of times to iterate before we assume that a point isn't in the
 	// Mandelbrot set.
@@ -76,16 +213,74 @@ protected:
 	int iteration_modifier_;
 	// Boolean to check if user has modified any variables and if the mandelbrot set needs recalculated as a result
 	bool recalculate;
-	// Booleans to check if the user is running tiled or non tiled
-	bool running_non_tiled, running_tiled;
-	// 2D Array for which the mandelbrot set information is stored in
-	uint32_t image[1920][1280];
+	// Only the colours have changed, the counts can be coloured again without recalculating
+	bool recolour;
+	// Rectangles of the frame on screen still to be coloured and uploaded
+	std::vector<Tile> dirty_rects;
+	// Milliseconds the last colour pass and texture upload took
+	double colour_time;
+	double upload_time;
+	// Whether the CPU modes compute a coarse preview first and refine it over the next updates
+	bool progressive;
+	// Microseconds the frame on screen has taken so far, summed over its passes when progressive
+	long long progressive_time;
+	// Nanoseconds per pixel of the last full CPU frame, what the first progressive step is chosen by
+	double pixel_time;
+	// Whether CPU Tiled frames reuse tiles from tile_cache
+	bool tile_cache_on;
+	// Frames that ran past FRAME_DEADLINE_MS and were started again progressively
+	unsigned deadline_misses;
+	// Which computation the user is running
+	ComputationMode computation_mode;
+	// Whether the CPU kernels stop early on orbits that repeat (Brent cycle detection)
+	bool periodicity_check;
+	// Iteration counts, double buffered: the worker computes into count_buffers[1 - front] while
+	// count_buffers[front] is coloured and shown, and they swap when it finishes. Each is resized
+	// to its frame's size by whichever thread is using it. frame_stats go with the buffer of the same index.
+	FrameBuffer count_buffers[2];
+	FrameStats frame_stats[2];
+	int front;
+	// Memory the frame on screen is coloured into and the texture it is uploaded to, resized to it
+	// as it is swapped in
+	TextureStreamer texture_stream;
+	// Colours for the colour pass, and threads of its own for it so it never waits for the
+	// worker's frame to finish with cpu_backend's pool
+	Palette palette;
+	ThreadPool colour_pool;
+	// C++ AMP backend, runs on whatever accelerator AMP picks as the default
+	AmpMandelbrot amp_backend;
+	// Multithreaded CPU backend, used when no AMP accelerator is wanted/available
+	CpuMandelbrot cpu_backend;
+	// Tiles of recent CPU Tiled frames, only used by the worker
+	TileCache tile_cache;
 	// Texture for which the mandelbrot set is applied to
 	GLuint mandelbrotTexture;
-	// .CSV file for which the timings of the calculations of the mandelbrot set are saved to
-	ofstream mandelbrot_timings_file;
+	// Entry points past OpenGL 1.1, and the vertex buffer of the quad (0 if there are no buffers)
+	GLFunctions gl;
+	GLuint quad_buffer;
+	// Text drawn over the image
+	HudText hud;
+	// Time each stage of a frame took, recorded by the render thread and the worker
+	FrameProfiler profiler;
+	// Number of the current update, what the render thread's profile samples are grouped by
+	unsigned long long frame_number;
+	// .CSV file for which the timings of the calculations of the mandelbrot set are saved to,
+	// written on a thread of its own. timing_record is the row of the frame just swapped in,
+	// waiting for its colour pass and upload times while timing_pending is set.
+	TimingLog timing_log;
+	TimingRecord timing_record;
+	bool timing_pending;
 
-	float X_Modifier_, Y_Modifier_, zoom_, movement_modifier_;
+	// Centre of the view in fixed point, float runs out of digits at a zoom of around 1e-4
+	FixedPoint X_Modifier_, Y_Modifier_;
+	double zoom_, movement_modifier_;
+	// zoom_ is 0.9^zoom_level, so zooming back out lands on exactly the zoom it left
+	int zoom_level;
+	// Whole pixels the view has moved since the last frame, positive is right/down the image.
+	// Movement is snapped to pixels so a CPU frame can just be scrolled (cpu_mandelbrot_scrolled).
+	int pan_x, pan_y;
+	// Whether count_buffers[front] holds a complete frame (not one part way through progressive refinement)
+	bool last_frame_valid;
 	int red, green, blue;
 
 	// string to ouput to screen what computation mode is running
@@ -101,19 +296,9 @@ protected:
 	// For FPS counter and mouse coordinate output.
 	int frame = 0, time = 0, timebase = 0;
 	char fps[40];
-	char mouseText[40];
-
-	// char arrays to output to screen
-	char iterationText[40];
-	char zoomText[40];
-
-	char blueText[40];
-	char greenText[40];
-	char redText[40];
-
-	char widthText[40];
-	char heightText[40];
 
-	char computationText[40];
+	// Computes the frames, declared last so it is destroyed (and waits for its job) before
+	// the buffers and backends the job uses
+	RenderWorker worker;
 };
 
@@ -0,0 +1,123 @@
+#pragma once
+
+// Portable versions of the escape-time maths used by the AMP kernels.
+// No AMP or GLUT here so the CPU backend can be built on any platform.
+// The maths is templated on the number type: float (what the AMP and SIMD kernels use),
+// double, or DoubleDouble for views zoomed in too far for double.
+#include <cmath>
+#include <stdint.h>
+#include "DoubleDouble.h"
+
+// Magnitude of a difference, as the type the cycle tolerance is compared in
+inline float kernel_abs(float a)
+{
+	return std::fabs(a);
+} // kernel_abs
+
+inline double kernel_abs(double a)
+{
+	return std::fabs(a);
+} // kernel_abs
+
+inline double kernel_abs(const DoubleDouble& a)
+{
+	return std::fabs(a.hi + a.lo);
+} // kernel_abs
+
+// Iterate z = z^2 + c from z = (0, 0) until z moves more than 2 units
+// away from (0, 0), or we've iterated max_iter times.
+// |z|^2 is compared against 4 so there is no sqrt per iteration.
+template <typename Real>
+inline unsigned escape_time(Real cx, Real cy, unsigned max_iter)
+{
+	Real zx = Real(0.0f);
+	Real zy = Real(0.0f);
+	Real four = Real(4.0f);
+
+	unsigned iterations = 0;
+	while (zx*zx + zy*zy < four && iterations < max_iter)
+	{
+		Real zx2 = zx*zx;
+		Real zy2 = zy*zy;
+		zy = zx*zy + zx*zy + cy;
+		zx = zx2 - zy2 + cx;
+
+		++iterations;
+	}
+	return iterations;
+} // escape_time
+
+// escape_time with Brent's cycle detection: z is saved at iterations 1, 2, 4, 8, ...
+// and if the orbit comes back within tolerance of the saved point it has settled into
+// a cycle, so the point is in the set and the remaining iterations are skipped.
+// saved is set to the number of iterations that didn't need to run.
+template <typename Real>
+inline unsigned escape_time_periodic(Real cx, Real cy, unsigned max_iter, float tolerance, unsigned& saved)
+{
+	Real zx = Real(0.0f);
+	Real zy = Real(0.0f);
+	Real saved_x = Real(0.0f);
+	Real saved_y = Real(0.0f);
+	Real four = Real(4.0f);
+	unsigned period_limit = 1;
+	unsigned period_steps = 0;
+
+	saved = 0;
+	unsigned iterations = 0;
+	while (zx*zx + zy*zy < four && iterations < max_iter)
+	{
+		Real zx2 = zx*zx;
+		Real zy2 = zy*zy;
+		zy = zx*zy + zx*zy + cy;
+		zx = zx2 - zy2 + cx;
+
+		++iterations;
+
+		if (kernel_abs(zx - saved_x) < tolerance && kernel_abs(zy - saved_y) < tolerance)
+		{
+			saved = max_iter - iterations;
+			return max_iter;
+		}
+		// Move the saved point on, doubling how long it's kept each time
+		if (++period_steps == period_limit)
+		{
+			saved_x = zx;
+			saved_y = zy;
+			period_steps = 0;
+			period_limit *= 2;
+		}
+	}
+	return iterations;
+} // escape_time_periodic
+
+// Analytic test for the two largest parts of the set, every point inside them is in the set
+// so the escape-time loop can be skipped. Same sums as c_in_cardioid_or_bulb in complex_amp.h.
+// Main cardioid: q(q + (x - 1/4)) < y^2 / 4 where q = (x - 1/4)^2 + y^2
+// Period-2 bulb: (x + 1)^2 + y^2 < 1/16
+template <typename Real>
+inline bool in_cardioid_or_bulb(Real cx, Real cy)
+{
+	Real xq = cx - Real(0.25f);
+	Real y2 = cy*cy;
+	Real q = xq*xq + y2;
+	if (q*(q + xq) < Real(0.25f)*y2)
+	{
+		return true;
+	}
+	Real xb = cx + Real(1.0f);
+	return xb*xb + y2 < Real(0.0625f);
+} // in_cardioid_or_bulb
+
+// Turn an iteration count into the BGR colour written to the image
+inline uint32_t colour_pixel(unsigned iterations, unsigned max_iter, unsigned r, unsigned g, unsigned b)
+{
+	if (iterations == max_iter)
+	{
+		// z didn't escape from the circle.
+		// This point is in the Mandelbrot set.
+		return 0x000000; // black
+	}
+	// z escaped within less than MAX_ITERATIONS
+	// iterations. This point isn't in the set.
+	return (b * iterations << 16) | (g * iterations << 8) | r * iterations;
+} // colour_pixel
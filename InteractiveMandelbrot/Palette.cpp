@@ -0,0 +1,259 @@
+#include "Palette.h"
+#include "MandelbrotKernel.h"
+#include "SimdTarget.h"
+
+// GCC 12's AVX-512 headers set off -Wmaybe-uninitialized on their own _mm512_undefined_*
+// placeholders (PR 105593), nothing in this file is uninitialised
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+Palette::Palette()
+{
+	max_iter = 0;
+	r = 0;
+	g = 0;
+	b = 0;
+}
+
+// Work out every colour once, colour_pixel is then never called per pixel
+void Palette::build(unsigned max_iterations, unsigned red, unsigned green, unsigned blue)
+{
+	if (!lut.empty() && max_iterations == max_iter && red == r && green == g && blue == b)
+	{
+		return;
+	}
+	max_iter = max_iterations;
+	r = red;
+	g = green;
+	b = blue;
+
+	lut.resize((size_t)max_iter + 1);
+	for (unsigned n = 0; n <= max_iter; n++)
+	{
+		lut[n] = colour_pixel(n, max_iter, r, g, b);
+	}
+} // build
+
+const uint32_t* Palette::table() const
+{
+	return lut.data();
+} // table
+
+unsigned Palette::maxIterations() const
+{
+	return max_iter;
+} // maxIterations
+
+void colour_row(const unsigned* counts, uint32_t* pixels, int count, unsigned max_iter, unsigned r, unsigned g, unsigned b)
+{
+	for (int i = 0; i < count; i++)
+	{
+		pixels[i] = colour_pixel(counts[i], max_iter, r, g, b);
+	}
+} // colour_row
+
+// Blend each byte of lo towards hi by weight/256
+static inline uint32_t blend_colours(uint32_t lo, uint32_t hi, unsigned weight)
+{
+	uint32_t result = 0;
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		unsigned from = (lo >> shift) & 0xFF;
+		unsigned to = (hi >> shift) & 0xFF;
+		result |= ((from * (256 - weight) + to * weight) >> 8) << shift;
+	}
+	return result;
+} // blend_colours
+
+// Scalar lookups, also used for the pixels left over after the last full vector
+static void palette_row_scalar(const uint32_t* lut, unsigned max_iter, const unsigned* counts, uint32_t* pixels, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		pixels[i] = lut[counts[i] < max_iter ? counts[i] : max_iter];
+	}
+} // palette_row_scalar
+
+static void palette_row_smooth_scalar(const uint32_t* lut, unsigned max_iter, const float* counts, uint32_t* pixels, int count)
+{
+	float limit = (float)max_iter;
+	for (int i = 0; i < count; i++)
+	{
+		// Negative and NaN counts are taken as 0
+		float v = counts[i] > 0.0f ? counts[i] : 0.0f;
+		if (v >= limit)
+		{
+			pixels[i] = lut[max_iter];
+			continue;
+		}
+		unsigned n = (unsigned)(int)v;
+		unsigned next = n + 1 < max_iter ? n + 1 : max_iter - 1;
+		unsigned weight = (unsigned)(int)((v - (float)(int)n) * 256.0f);
+		pixels[i] = blend_colours(lut[n], lut[next], weight);
+	}
+} // palette_row_smooth_scalar
+
+#if SIMD_X86
+// One byte channel of 8 blended colours, at bit SHIFT
+template <int SHIFT>
+SIMD_TARGET_AVX2
+static inline __m256i blend_channel_avx2(__m256i lo, __m256i hi, __m256i weight, __m256i inverse)
+{
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	__m256i from = _mm256_and_si256(_mm256_srli_epi32(lo, SHIFT), byte_mask);
+	__m256i to = _mm256_and_si256(_mm256_srli_epi32(hi, SHIFT), byte_mask);
+	__m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(from, inverse), _mm256_mullo_epi32(to, weight));
+	return _mm256_slli_epi32(_mm256_srli_epi32(sum, 8), SHIFT);
+} // blend_channel_avx2
+
+SIMD_TARGET_AVX2
+static void palette_row_avx2(const uint32_t* lut, unsigned max_iter, const unsigned* counts, uint32_t* pixels, int count)
+{
+	const __m256i limit = _mm256_set1_epi32((int)max_iter);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i n = _mm256_min_epu32(_mm256_loadu_si256((const __m256i*)(counts + i)), limit);
+		_mm256_storeu_si256((__m256i*)(pixels + i), _mm256_i32gather_epi32((const int*)lut, n, 4));
+	}
+	palette_row_scalar(lut, max_iter, counts + i, pixels + i, count - i);
+} // palette_row_avx2
+
+SIMD_TARGET_AVX2
+static void palette_row_smooth_avx2(const uint32_t* lut, unsigned max_iter, const float* counts, uint32_t* pixels, int count)
+{
+	const __m256 limit = _mm256_set1_ps((float)max_iter);
+	const __m256i set_index = _mm256_set1_epi32((int)max_iter);
+	const __m256i last_escaped = _mm256_set1_epi32((int)max_iter - 1);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i full_weight = _mm256_set1_epi32(256);
+	const __m256 scale = _mm256_set1_ps(256.0f);
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		// Negative and NaN counts are taken as 0, the same test as the scalar path
+		__m256 v = _mm256_loadu_ps(counts + i);
+		v = _mm256_and_ps(v, _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GT_OQ));
+		__m256i in_set = _mm256_castps_si256(_mm256_cmp_ps(v, limit, _CMP_GE_OQ));
+
+		__m256i n = _mm256_cvttps_epi32(v);
+		__m256i next = _mm256_min_epu32(_mm256_add_epi32(n, one), last_escaped);
+		__m256i weight = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(v, _mm256_cvtepi32_ps(n)), scale));
+		// Points in the set look up max_iter for both ends, so the blend leaves its colour alone
+		n = _mm256_blendv_epi8(n, set_index, in_set);
+		next = _mm256_blendv_epi8(next, set_index, in_set);
+
+		__m256i lo = _mm256_i32gather_epi32((const int*)lut, n, 4);
+		__m256i hi = _mm256_i32gather_epi32((const int*)lut, next, 4);
+		__m256i inverse = _mm256_sub_epi32(full_weight, weight);
+		__m256i result = _mm256_or_si256(
+			_mm256_or_si256(blend_channel_avx2<0>(lo, hi, weight, inverse), blend_channel_avx2<8>(lo, hi, weight, inverse)),
+			_mm256_or_si256(blend_channel_avx2<16>(lo, hi, weight, inverse), blend_channel_avx2<24>(lo, hi, weight, inverse)));
+		_mm256_storeu_si256((__m256i*)(pixels + i), result);
+	}
+	palette_row_smooth_scalar(lut, max_iter, counts + i, pixels + i, count - i);
+} // palette_row_smooth_avx2
+#endif
+
+#if SIMD_HAS_AVX512
+// One byte channel of 16 blended colours, at bit SHIFT
+template <int SHIFT>
+SIMD_TARGET_AVX512
+static inline __m512i blend_channel_avx512(__m512i lo, __m512i hi, __m512i weight, __m512i inverse)
+{
+	const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+	__m512i from = _mm512_and_si512(_mm512_srli_epi32(lo, SHIFT), byte_mask);
+	__m512i to = _mm512_and_si512(_mm512_srli_epi32(hi, SHIFT), byte_mask);
+	__m512i sum = _mm512_add_epi32(_mm512_mullo_epi32(from, inverse), _mm512_mullo_epi32(to, weight));
+	return _mm512_slli_epi32(_mm512_srli_epi32(sum, 8), SHIFT);
+} // blend_channel_avx512
+
+SIMD_TARGET_AVX512
+static void palette_row_avx512(const uint32_t* lut, unsigned max_iter, const unsigned* counts, uint32_t* pixels, int count)
+{
+	const __m512i limit = _mm512_set1_epi32((int)max_iter);
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i n = _mm512_min_epu32(_mm512_loadu_si512(counts + i), limit);
+		_mm512_storeu_si512(pixels + i, _mm512_i32gather_epi32(n, (const int*)lut, 4));
+	}
+	palette_row_scalar(lut, max_iter, counts + i, pixels + i, count - i);
+} // palette_row_avx512
+
+SIMD_TARGET_AVX512
+static void palette_row_smooth_avx512(const uint32_t* lut, unsigned max_iter, const float* counts, uint32_t* pixels, int count)
+{
+	const __m512 limit = _mm512_set1_ps((float)max_iter);
+	const __m512i set_index = _mm512_set1_epi32((int)max_iter);
+	const __m512i last_escaped = _mm512_set1_epi32((int)max_iter - 1);
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i full_weight = _mm512_set1_epi32(256);
+	const __m512 scale = _mm512_set1_ps(256.0f);
+	int i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		// Negative and NaN counts are taken as 0, the same test as the scalar path
+		__m512 v = _mm512_loadu_ps(counts + i);
+		v = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(v, _mm512_setzero_ps(), _CMP_GT_OQ), v);
+		__mmask16 in_set = _mm512_cmp_ps_mask(v, limit, _CMP_GE_OQ);
+
+		__m512i n = _mm512_cvttps_epi32(v);
+		__m512i next = _mm512_min_epu32(_mm512_add_epi32(n, one), last_escaped);
+		__m512i weight = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_sub_ps(v, _mm512_cvtepi32_ps(n)), scale));
+		// Points in the set look up max_iter for both ends, so the blend leaves its colour alone
+		n = _mm512_mask_blend_epi32(in_set, n, set_index);
+		next = _mm512_mask_blend_epi32(in_set, next, set_index);
+
+		__m512i lo = _mm512_i32gather_epi32(n, (const int*)lut, 4);
+		__m512i hi = _mm512_i32gather_epi32(next, (const int*)lut, 4);
+		__m512i inverse = _mm512_sub_epi32(full_weight, weight);
+		__m512i result = _mm512_or_si512(
+			_mm512_or_si512(blend_channel_avx512<0>(lo, hi, weight, inverse), blend_channel_avx512<8>(lo, hi, weight, inverse)),
+			_mm512_or_si512(blend_channel_avx512<16>(lo, hi, weight, inverse), blend_channel_avx512<24>(lo, hi, weight, inverse)));
+		_mm512_storeu_si512(pixels + i, result);
+	}
+	palette_row_smooth_scalar(lut, max_iter, counts + i, pixels + i, count - i);
+} // palette_row_smooth_avx512
+#endif
+
+// Dispatch to the lookup loop for the requested instruction set
+void palette_row(SimdLevel level, const Palette& palette, const unsigned* counts, uint32_t* pixels, int count)
+{
+#if SIMD_HAS_AVX512
+	if (level == SIMD_AVX512)
+	{
+		palette_row_avx512(palette.table(), palette.maxIterations(), counts, pixels, count);
+		return;
+	}
+#endif
+#if SIMD_X86
+	if (level >= SIMD_AVX2)
+	{
+		palette_row_avx2(palette.table(), palette.maxIterations(), counts, pixels, count);
+		return;
+	}
+#endif
+	palette_row_scalar(palette.table(), palette.maxIterations(), counts, pixels, count);
+} // palette_row
+
+// Dispatch to the smooth lookup loop for the requested instruction set
+void palette_row_smooth(SimdLevel level, const Palette& palette, const float* counts, uint32_t* pixels, int count)
+{
+#if SIMD_HAS_AVX512
+	if (level == SIMD_AVX512)
+	{
+		palette_row_smooth_avx512(palette.table(), palette.maxIterations(), counts, pixels, count);
+		return;
+	}
+#endif
+#if SIMD_X86
+	if (level >= SIMD_AVX2)
+	{
+		palette_row_smooth_avx2(palette.table(), palette.maxIterations(), counts, pixels, count);
+		return;
+	}
+#endif
+	palette_row_smooth_scalar(palette.table(), palette.maxIterations(), counts, pixels, count);
+} // palette_row_smooth
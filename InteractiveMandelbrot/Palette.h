@@ -0,0 +1,45 @@
+#pragma once
+
+// Colour mapping, run as its own pass over a frame of iteration counts.
+// The kernels only write counts, so changing the colours re-colours the counts already
+// there instead of computing the set again.
+#include <stdint.h>
+#include <vector>
+#include "SimdKernel.h"
+
+// Palette class
+// Lookup table from iteration count to colour for one max_iter and set of colour multipliers.
+// Entry n is the colour of a point that escaped after n iterations and entry max_iter is the
+// set itself, so mapping a pixel is one load (a gather in the vector paths) however the
+// colours were worked out, and a richer palette costs no more per pixel than the default.
+class Palette
+{
+public:
+	Palette();
+
+	// Fill the table with colour_pixel's colours, does nothing if none of the values have changed
+	void build(unsigned max_iter, unsigned r, unsigned g, unsigned b);
+
+	// max_iter + 1 entries
+	const uint32_t* table() const;
+	unsigned maxIterations() const;
+
+protected:
+	std::vector<uint32_t> lut;
+	unsigned max_iter;
+	unsigned r, g, b;
+};
+
+// Colour count pixels with colour_pixel's shift-and-or formula, pixels[i] = colour_pixel(counts[i], ...).
+// What the kernels used to do inline, kept to benchmark the lookup table against.
+// pixels may be the same memory as counts to colour in place.
+void colour_row(const unsigned* counts, uint32_t* pixels, int count, unsigned max_iter, unsigned r, unsigned g, unsigned b);
+
+// Colour count pixels through the palette, counts above its max_iter are treated as max_iter.
+// Every level gives the same colours. pixels may be the same memory as counts.
+void palette_row(SimdLevel level, const Palette& palette, const unsigned* counts, uint32_t* pixels, int count);
+
+// Colour count pixels with fractional (smooth) iteration counts, blending each channel of the
+// two entries either side of the count by its fraction, in 1/256ths. Counts of max_iter or
+// more are the set. Every level gives the same colours.
+void palette_row_smooth(SimdLevel level, const Palette& palette, const float* counts, uint32_t* pixels, int count);
@@ -0,0 +1,206 @@
+#include "Perturbation.h"
+#include <cmath>
+
+ReferenceOrbit::ReferenceOrbit()
+{
+	orbit_max_iter = 0;
+}
+
+// Iterate the centre in fixed point, storing every point as a double
+void ReferenceOrbit::compute(const FixedPoint& cx, const FixedPoint& cy, unsigned max_iter)
+{
+	if (!orbit_x.empty() && cx == centre_x && cy == centre_y && max_iter == orbit_max_iter)
+	{
+		return;
+	}
+	centre_x = cx;
+	centre_y = cy;
+	orbit_max_iter = max_iter;
+
+	orbit_x.clear();
+	orbit_y.clear();
+	orbit_x.push_back(0.0);
+	orbit_y.push_back(0.0);
+
+	FixedPoint zx;
+	FixedPoint zy;
+	for (unsigned n = 0; n < max_iter; n++)
+	{
+		FixedPoint zx2 = zx * zx;
+		FixedPoint zy2 = zy * zy;
+		FixedPoint zxy = zx * zy;
+		zy = zxy + zxy + cy;
+		zx = zx2 - zy2 + cx;
+
+		double x = to_double(zx);
+		double y = to_double(zy);
+		orbit_x.push_back(x);
+		orbit_y.push_back(y);
+		// Escaped, the pixels that outlive it are rebased (escape_time_row_perturbed)
+		if (x*x + y*y >= 4.0)
+		{
+			break;
+		}
+	}
+} // compute
+
+unsigned ReferenceOrbit::length() const
+{
+	return (unsigned)orbit_x.size();
+} // length
+
+const double* ReferenceOrbit::x() const
+{
+	return orbit_x.data();
+} // x
+
+const double* ReferenceOrbit::y() const
+{
+	return orbit_y.data();
+} // y
+
+// (x, y) * (u, v) as complex numbers
+static inline void complex_multiply(double x, double y, double u, double v, double& result_x, double& result_y)
+{
+	result_x = x*u - y*v;
+	result_y = x*v + y*u;
+} // complex_multiply
+
+// Step the scaled coefficients along the reference orbit while the cubic term stays negligible
+SeriesApproximation series_approximation(const ReferenceOrbit& orbit, const Viewport& view, unsigned max_iter)
+{
+	SeriesApproximation series = {};
+	double rx = std::fmax(std::fabs(view.left_), std::fabs(view.right_));
+	double ry = std::fmax(std::fabs(view.top_), std::fabs(view.bottom_));
+	series.radius = std::sqrt(rx*rx + ry*ry);
+	if (series.radius == 0.0)
+	{
+		return series;
+	}
+
+	const double* ref_x = orbit.x();
+	const double* ref_y = orbit.y();
+	unsigned last = orbit.length() - 1;
+	double ax = 0.0, ay = 0.0, bx = 0.0, by = 0.0, cx = 0.0, cy = 0.0;
+	// Pixels have to start before the last point, they step from the one they start at
+	for (unsigned n = 0; n + 1 < last && n < max_iter; n++)
+	{
+		double zx2 = 2.0 * ref_x[n];
+		double zy2 = 2.0 * ref_y[n];
+		double tx, ty;
+
+		// a = 2 Z a + r
+		double next_ax, next_ay;
+		complex_multiply(zx2, zy2, ax, ay, next_ax, next_ay);
+		next_ax += series.radius;
+		// b = 2 Z b + a^2
+		double next_bx, next_by;
+		complex_multiply(zx2, zy2, bx, by, next_bx, next_by);
+		complex_multiply(ax, ay, ax, ay, tx, ty);
+		next_bx += tx;
+		next_by += ty;
+		// c = 2 Z c + 2 a b
+		double next_cx, next_cy;
+		complex_multiply(zx2, zy2, cx, cy, next_cx, next_cy);
+		complex_multiply(ax, ay, bx, by, tx, ty);
+		next_cx += 2.0 * tx;
+		next_cy += 2.0 * ty;
+
+		// |c| u^3 at |u| = 1 is as big as the neglected terms get, compare it with |a| u
+		double a2 = next_ax*next_ax + next_ay*next_ay;
+		double c2 = next_cx*next_cx + next_cy*next_cy;
+		if (c2 > SERIES_TOLERANCE * SERIES_TOLERANCE * a2)
+		{
+			break;
+		}
+
+		ax = next_ax;
+		ay = next_ay;
+		bx = next_bx;
+		by = next_by;
+		cx = next_cx;
+		cy = next_cy;
+		series.skip = n + 1;
+	}
+
+	series.ax = ax;
+	series.ay = ay;
+	series.bx = bx;
+	series.by = by;
+	series.cx = cx;
+	series.cy = cy;
+	return series;
+} // series_approximation
+
+void escape_time_row_perturbed(const ReferenceOrbit& orbit, const SeriesApproximation& series, unsigned* iterations, int x0, int count, int y, int width, int height, const Viewport& view, unsigned max_iter, KernelStats& stats)
+{
+	const double* ref_x = orbit.x();
+	const double* ref_y = orbit.y();
+	unsigned last = orbit.length() - 1;
+
+	// Offsets from the centre, the same pixel mapping as the other kernels without the centre added
+	double dcy = view.top_ + (y * (view.bottom_ - view.top_) / height);
+	double span_x = view.right_ - view.left_;
+
+	for (int i = 0; i < count; i++)
+	{
+		double dcx = view.left_ + ((x0 + i) * span_x / width);
+		double dzx = 0.0;
+		double dzy = 0.0;
+		unsigned ref = 0;
+		unsigned n = 0;
+
+		// Jump straight to iteration skip, dz = ((c u + b) u + a) u
+		if (series.skip > 0)
+		{
+			double ux = dcx / series.radius;
+			double uy = dcy / series.radius;
+			double sx, sy;
+			complex_multiply(series.cx, series.cy, ux, uy, sx, sy);
+			complex_multiply(sx + series.bx, sy + series.by, ux, uy, sx, sy);
+			complex_multiply(sx + series.ax, sy + series.ay, ux, uy, sx, sy);
+
+			double zx = ref_x[series.skip] + sx;
+			double zy = ref_y[series.skip] + sy;
+			// A pixel that escaped before then has to be iterated from the start to find when
+			if (zx*zx + zy*zy < 4.0)
+			{
+				dzx = sx;
+				dzy = sy;
+				ref = series.skip;
+				n = series.skip;
+			}
+		}
+
+		while (n < max_iter)
+		{
+			// dz = (2Z + dz) dz + dc
+			double tx = 2.0 * ref_x[ref] + dzx;
+			double ty = 2.0 * ref_y[ref] + dzy;
+			double next_dzx = tx*dzx - ty*dzy + dcx;
+			dzy = tx*dzy + ty*dzx + dcy;
+			dzx = next_dzx;
+			++ref;
+			++n;
+
+			// Where the pixel actually is
+			double zx = ref_x[ref] + dzx;
+			double zy = ref_y[ref] + dzy;
+			double z2 = zx*zx + zy*zy;
+			if (z2 >= 4.0)
+			{
+				break;
+			}
+			// Glitch, or the reference has run out: carry on from the start of the orbit,
+			// where Z(0) = 0 so dz is just z. Not worth doing (or counting) on the last iteration.
+			if (n < max_iter && (z2 < dzx*dzx + dzy*dzy || ref == last))
+			{
+				dzx = zx;
+				dzy = zy;
+				ref = 0;
+				stats.rebased++;
+			}
+		}
+		iterations[i] = n;
+	}
+} // escape_time_row_perturbed
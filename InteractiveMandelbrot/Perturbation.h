@@ -0,0 +1,72 @@
+#pragma once
+
+// Perturbation theory for views zoomed in past double-double.
+// One orbit is iterated in fixed point at the centre of the view, Z(n+1) = Z(n)^2 + C, and
+// stored as doubles. Every pixel c = C + dc then only iterates its difference from it,
+//   dz(n+1) = 2 Z(n) dz(n) + dz(n)^2 + dc
+// which stays small enough for double however deep the view is, so the per-pixel cost is
+// a few double operations instead of a few hundred bits of fixed point.
+#include <vector>
+#include "FixedPoint.h"
+#include "SimdKernel.h"
+#include "Viewport.h"
+
+// ReferenceOrbit class
+// The orbit of the view centre, Z(0) = 0 up to the iteration it escapes or max_iter.
+class ReferenceOrbit
+{
+public:
+	ReferenceOrbit();
+
+	// Iterate the orbit of C = (cx, cy). Keeps the orbit already held if it is for the same point
+	// and max_iter, so the bands of a poster or repeated frames only pay for it once.
+	void compute(const FixedPoint& cx, const FixedPoint& cy, unsigned max_iter);
+
+	// Number of points held, Z(0) to Z(length - 1)
+	unsigned length() const;
+	const double* x() const;
+	const double* y() const;
+
+protected:
+	FixedPoint centre_x, centre_y;
+	unsigned orbit_max_iter;
+	std::vector<double> orbit_x, orbit_y;
+};
+
+// Largest truncation error, relative to the linear term, the series may have before it stops.
+// Measured at the corner of the view furthest from the centre, so it is the worst pixel's error.
+// Chaotic pixels near the boundary magnify any error, 1e-6 was visibly worse than not skipping,
+// 1e-10 matches the unskipped image as well as double can.
+#define SERIES_TOLERANCE 1e-10
+
+// SeriesApproximation struct
+// While every dz in the view is still small, dz(n) is a polynomial in dc:
+//   dz(n) = A(n) dc + B(n) dc^2 + C(n) dc^3 + ...
+//   A(n+1) = 2 Z(n) A(n) + 1, B(n+1) = 2 Z(n) B(n) + A(n)^2, C(n+1) = 2 Z(n) C(n) + 2 A(n) B(n)
+// so every pixel can start at iteration skip with three complex multiplies instead of iterating
+// up to it. The coefficients are held scaled by radius (a = A r, b = B r^2, c = C r^3, with dc = u r
+// and |u| <= 1) so they stay in double's range however deep the view is.
+struct SeriesApproximation
+{
+	// Iterations every pixel starts at, 0 when the series isn't used
+	unsigned skip;
+	// Distance from the centre to the furthest corner of the view
+	double radius;
+	double ax, ay, bx, by, cx, cy;
+};
+
+// Run the series along the reference orbit until the cubic term stops being negligible next to
+// the linear one (SERIES_TOLERANCE) anywhere in the view, or the orbit runs out
+SeriesApproximation series_approximation(const ReferenceOrbit& orbit, const Viewport& view, unsigned max_iter);
+
+// Compute the iteration counts for count pixels of row y of a width x height frame, starting
+// at pixel x0, by perturbing the reference orbit of the view centre. Same counts as escape_time
+// wherever double holds the difference, no cardioid/bulb test or cycle detection since both
+// need the absolute position of the point.
+// Glitches (where the pixel's orbit passes close to 0 and the difference becomes as large as the
+// orbit itself, so the next iterations can no longer be told apart from the reference's) are
+// caught with |z| < |dz|. The pixel is then re-referenced against the start of the same orbit,
+// dz = z and n = 0, which is also done when it outlives a reference that escaped (Zhuoran's
+// rebasing). One reference per frame is enough this way, stats.rebased counts how often it happened.
+// Pixels start series.skip iterations in; any that have already escaped there are iterated from 0.
+void escape_time_row_perturbed(const ReferenceOrbit& orbit, const SeriesApproximation& series, unsigned* iterations, int x0, int count, int y, int width, int height, const Viewport& view, unsigned max_iter, KernelStats& stats);
@@ -0,0 +1,127 @@
+#include "PosterRenderer.h"
+#include <new>
+#include <thread>
+
+PosterRenderer::PosterRenderer(CpuMandelbrot& cpu_backend) : backend(cpu_backend)
+{
+	memory_budget = POSTER_DEFAULT_BUDGET;
+	band_count = 0;
+	peak_bytes = 0;
+	skipped_pixels = 0;
+}
+
+PosterRenderer::~PosterRenderer()
+{
+}
+
+void PosterRenderer::setMemoryBudget(size_t bytes)
+{
+	memory_budget = bytes;
+} // setMemoryBudget
+
+// Split the budget between the two bands, a row costs its padded stride
+int PosterRenderer::bandHeight(int width) const
+{
+	size_t stride = (width + FRAME_STRIDE_PIXELS - 1) / FRAME_STRIDE_PIXELS * FRAME_STRIDE_PIXELS;
+	size_t row_bytes = stride * sizeof(uint32_t);
+	size_t rows = memory_budget / 2 / row_bytes;
+	if (rows < 1)
+	{
+		rows = 1;
+	}
+	return rows > 0x7FFFFFFF ? 0x7FFFFFFF : (int)rows;
+} // bandHeight
+
+// Compute each band while the previous one is written out
+bool PosterRenderer::render(const char* filename, int width, int height, const Viewport& view, const std::function<void(int, int)>& progress)
+{
+	band_count = 0;
+	peak_bytes = 0;
+	skipped_pixels = 0;
+
+	int band_height = bandHeight(width);
+	if (band_height > height)
+	{
+		band_height = height;
+	}
+
+	PpmStreamWriter writer;
+	if (!writer.open(filename, width, height))
+	{
+		return false;
+	}
+
+	try
+	{
+		bands[0].resize(width, band_height);
+		if (band_height < height)
+		{
+			bands[1].resize(width, band_height);
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		bands[0].resize(0, 0);
+		bands[1].resize(0, 0);
+		writer.close();
+		return false;
+	}
+	peak_bytes = bands[0].bytes() + bands[1].bytes();
+
+	std::thread write_thread;
+	bool written = true;
+	for (int y = 0; y < height; y += band_height)
+	{
+		FrameBuffer& band = bands[band_count % 2];
+		Tile region = { 0, y, width, height - y < band_height ? height - y : band_height };
+
+		backend.cpu_mandelbrot_region(band.data(), band.stride(), width, height, region, view);
+		backend.colour(band.data(), band.stride(), band.data(), band.stride(), width, region.height);
+		skipped_pixels += backend.skippedPixels();
+
+		// The other band has to be on disk before this one can go, rows must stay in order
+		if (write_thread.joinable())
+		{
+			write_thread.join();
+		}
+		if (!written)
+		{
+			break;
+		}
+		write_thread = std::thread([&writer, &written, &band, region]()
+		{
+			written = writer.writeRows(band.data(), region.height, band.stride());
+		});
+		band_count++;
+
+		if (progress)
+		{
+			progress(y + region.height, height);
+		}
+	}
+	if (write_thread.joinable())
+	{
+		write_thread.join();
+	}
+
+	// Give the memory back, the next poster may be a different width
+	bands[0].resize(0, 0);
+	bands[1].resize(0, 0);
+
+	return writer.close() && written;
+} // render
+
+int PosterRenderer::bandCount() const
+{
+	return band_count;
+} // bandCount
+
+size_t PosterRenderer::peakBytes() const
+{
+	return peak_bytes;
+} // peakBytes
+
+long long PosterRenderer::skippedPixels() const
+{
+	return skipped_pixels;
+} // skippedPixels
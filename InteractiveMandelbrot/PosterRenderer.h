@@ -0,0 +1,49 @@
+#pragma once
+
+// Out-of-core rendering for images too big to hold in memory (e.g. 64k x 64k prints).
+#include <functional>
+#include <stddef.h>
+#include "CpuMandelbrot.h"
+#include "FrameBuffer.h"
+#include "ImageWriter.h"
+
+// Default memory for the band buffers, 256 MB
+#define POSTER_DEFAULT_BUDGET (256u * 1024u * 1024u)
+
+// PosterRenderer class
+// Computes a frame a band of rows at a time on every core (cpu_mandelbrot_region), colours
+// each band in place and streams it to a PPM, so memory stays within the budget whatever the size.
+// Two bands are in use at once: one being computed while the other is written out.
+// Pixels map to the plane exactly as in gpu_amp_mandelbrot, so a poster matches a
+// normal render of the same viewport at the same resolution.
+class PosterRenderer
+{
+public:
+	PosterRenderer(CpuMandelbrot& cpu_backend);
+	~PosterRenderer();
+
+	// Most memory both band buffers together may use, in bytes
+	void setMemoryBudget(size_t bytes);
+	// Rows per band for an image this wide, at least 1 even if a single row is over budget
+	int bandHeight(int width) const;
+
+	// Render a width x height image of the viewport into filename.
+	// progress (if set) is called after each band with the rows finished so far.
+	// Returns false if the file couldn't be written or a band couldn't be allocated.
+	bool render(const char* filename, int width, int height, const Viewport& view, const std::function<void(int, int)>& progress = std::function<void(int, int)>());
+
+	// Results of the last render
+	int bandCount() const;
+	// Bytes the band buffers actually used
+	size_t peakBytes() const;
+	long long skippedPixels() const;
+
+protected:
+	CpuMandelbrot& backend;
+	size_t memory_budget;
+
+	FrameBuffer bands[2];
+	int band_count;
+	size_t peak_bytes;
+	long long skipped_pixels;
+};
@@ -0,0 +1,111 @@
+// The double-double error-free transformations break if GCC fuses their multiplies and adds
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include "PrecisionKernel.h"
+#include <cfloat>
+#include <cmath>
+#include "MandelbrotKernel.h"
+
+const char* precision_name(Precision precision)
+{
+	switch (precision)
+	{
+	case PRECISION_FLOAT:
+		return "Float";
+	case PRECISION_DOUBLE:
+		return "Double";
+	case PRECISION_DOUBLE_DOUBLE:
+		return "Double-double";
+	case PRECISION_PERTURBATION:
+		return "Perturbation";
+	default:
+		return "Auto";
+	}
+} // precision_name
+
+// Compare the pixel spacing with the rounding error at the largest coordinate in view
+Precision required_precision(const Viewport& view, int width, int height)
+{
+	double x = to_double(view.x);
+	double y = to_double(view.y);
+	double magnitude = std::fabs(x + view.left_);
+	magnitude = std::fmax(magnitude, std::fabs(x + view.right_));
+	magnitude = std::fmax(magnitude, std::fabs(y + view.top_));
+	magnitude = std::fmax(magnitude, std::fabs(y + view.bottom_));
+	// Around the origin the spacing itself sets the scale
+	magnitude = std::fmax(magnitude, 1e-300);
+
+	double spacing = viewport_pixel_spacing(view, width, height);
+	if (spacing >= magnitude * FLT_EPSILON * PRECISION_GUARD_ULPS)
+	{
+		return PRECISION_FLOAT;
+	}
+	if (spacing >= magnitude * DBL_EPSILON * PRECISION_GUARD_ULPS)
+	{
+		return PRECISION_DOUBLE;
+	}
+	return PRECISION_PERTURBATION;
+} // required_precision
+
+// Centre plus an offset from it, rounded to the kernel's number type
+static void plane_coordinate(const DoubleDouble& centre, double offset, double& result)
+{
+	result = centre.hi + (centre.lo + offset);
+} // plane_coordinate
+
+static void plane_coordinate(const DoubleDouble& centre, double offset, DoubleDouble& result)
+{
+	result = centre + DoubleDouble(offset);
+} // plane_coordinate
+
+// One row in the given number type
+template <typename Real>
+static void escape_time_row_real(unsigned* iterations, int x0, int count, int y, int width, int height, const Viewport& view, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	DoubleDouble centre_x = to_double_double(view.x);
+	DoubleDouble centre_y = to_double_double(view.y);
+
+	Real cy;
+	plane_coordinate(centre_y, view.top_ + (y * (view.bottom_ - view.top_) / height), cy);
+	double span_x = view.right_ - view.left_;
+
+	for (int i = 0; i < count; i++)
+	{
+		Real cx;
+		plane_coordinate(centre_x, view.left_ + ((x0 + i) * span_x / width), cx);
+
+		if (in_cardioid_or_bulb(cx, cy))
+		{
+			iterations[i] = max_iter;
+			stats.skipped++;
+		}
+		else if (period_tolerance > 0.0f)
+		{
+			unsigned saved;
+			iterations[i] = escape_time_periodic(cx, cy, max_iter, period_tolerance, saved);
+			if (saved > 0)
+			{
+				stats.periodic++;
+				stats.iterations_saved += saved;
+			}
+		}
+		else
+		{
+			iterations[i] = escape_time(cx, cy, max_iter);
+		}
+	}
+} // escape_time_row_real
+
+void escape_time_row_precise(Precision precision, unsigned* iterations, int x0, int count, int y, int width, int height, const Viewport& view, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	if (precision == PRECISION_DOUBLE_DOUBLE)
+	{
+		escape_time_row_real<DoubleDouble>(iterations, x0, count, y, width, height, view, max_iter, period_tolerance, stats);
+	}
+	else
+	{
+		escape_time_row_real<double>(iterations, x0, count, y, width, height, view, max_iter, period_tolerance, stats);
+	}
+} // escape_time_row_precise
@@ -0,0 +1,36 @@
+#pragma once
+
+// Escape-time kernels for views zoomed in past what float can resolve.
+#include "SimdKernel.h"
+#include "Viewport.h"
+
+// Number type the kernels iterate with, cheapest first
+enum Precision
+{
+	PRECISION_FLOAT = 0,
+	PRECISION_DOUBLE,
+	PRECISION_DOUBLE_DOUBLE,
+	// Double deltas against a fixed-point reference orbit at the centre (Perturbation.h)
+	PRECISION_PERTURBATION,
+	// Not a type: pick the cheapest one that resolves the view (required_precision)
+	PRECISION_AUTO
+};
+
+// How many units in the last place neighbouring pixels have to be apart before a precision
+// counts as resolving them. Rounding errors grow as the orbit is iterated, so one ulp
+// per pixel isn't enough to keep the image from breaking into blocks near the boundary.
+#define PRECISION_GUARD_ULPS 32.0
+
+// Printable name of a Precision, e.g. "Double"
+const char* precision_name(Precision precision);
+
+// The cheapest precision whose rounding error is well below the pixel spacing of the view.
+// Float runs to a zoom of around 1e-4 and double to around 1e-12, past that perturbation is
+// picked: it is several times faster than double-double and goes as deep as FixedPoint does.
+Precision required_precision(const Viewport& view, int width, int height);
+
+// Compute the iteration counts for count pixels of row y of a width x height frame, starting
+// at pixel x0, in double or double-double. Same pixel mapping, cardioid/bulb test and cycle
+// detection as escape_time_row, but scalar: a double-double multiply is ~20 double operations,
+// which dwarfs anything vectorising the loop would save.
+void escape_time_row_precise(Precision precision, unsigned* iterations, int x0, int count, int y, int width, int height, const Viewport& view, unsigned max_iter, float period_tolerance, KernelStats& stats);
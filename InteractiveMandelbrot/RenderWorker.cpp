@@ -0,0 +1,108 @@
+#include "RenderWorker.h"
+
+RenderWorker::RenderWorker()
+{
+	has_pending = false;
+	submitted = 0;
+	running = 0;
+	completed = 0;
+	collected = true;
+	dropped = 0;
+	stopping = false;
+
+	thread = std::thread(&RenderWorker::workerLoop, this);
+}
+
+RenderWorker::~RenderWorker()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	job_ready.notify_all();
+	thread.join();
+}
+
+// Replace any job still waiting with this one
+unsigned long long RenderWorker::submit(const std::function<void(unsigned long long)>& job)
+{
+	unsigned long long generation;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (has_pending)
+		{
+			++dropped;
+		}
+		pending = job;
+		has_pending = true;
+		generation = ++submitted;
+	}
+	job_ready.notify_all();
+	return generation;
+} // submit
+
+// Only the newest job counts, a stale one finishing leaves this false
+bool RenderWorker::finished()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (collected || completed != submitted)
+	{
+		return false;
+	}
+	collected = true;
+	return true;
+} // finished
+
+bool RenderWorker::busy() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return has_pending || running != 0;
+} // busy
+
+unsigned long long RenderWorker::generation() const
+{
+	return submitted.load();
+} // generation
+
+bool RenderWorker::stale(unsigned long long generation) const
+{
+	return submitted.load(std::memory_order_relaxed) != generation;
+} // stale
+
+unsigned long long RenderWorker::droppedCount() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return dropped;
+} // droppedCount
+
+// Wait for jobs and run them until the worker is destroyed
+void RenderWorker::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		job_ready.wait(lock, [this] { return stopping || has_pending; });
+		if (stopping)
+		{
+			return;
+		}
+
+		std::function<void(unsigned long long)> job;
+		job.swap(pending);
+		has_pending = false;
+		// A job replaced while it waited was never started, this is the newest one there is
+		running = submitted;
+		lock.unlock();
+
+		job(running);
+
+		lock.lock();
+		if (running != submitted)
+		{
+			++dropped;
+		}
+		completed = running;
+		collected = false;
+		running = 0;
+	}
+} // workerLoop
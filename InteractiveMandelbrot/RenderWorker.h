@@ -0,0 +1,60 @@
+#pragma once
+
+// Standard library only, like the thread pool it hands its frames to.
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// RenderWorker class
+// Runs frame computations one at a time on a thread of its own, so the GLUT loop keeps drawing
+// (and reading input) at display rate while a frame computes. Only the newest job matters: one
+// submitted while another is waiting replaces it, and one running when a newer one is submitted
+// becomes stale and finished() never reports it, so its result is never shown.
+// Every job is numbered (its generation) and is passed its number when it runs, so it can poll
+// stale() as it goes and give up as soon as it has been replaced.
+class RenderWorker
+{
+public:
+	RenderWorker();
+	// Waits for the running job, a waiting one is dropped
+	~RenderWorker();
+
+	// Queue job to run once the current one (if any) has finished. Returns its generation,
+	// which is also what job is called with.
+	unsigned long long submit(const std::function<void(unsigned long long)>& job);
+
+	// True once, on the first call after the newest job submitted has finished. Everything the
+	// job wrote is visible to the caller from then on, until it submits another.
+	bool finished();
+	// Whether a job is waiting or running
+	bool busy() const;
+	// Generation of the newest job submitted, 0 before the first
+	unsigned long long generation() const;
+	// Whether a newer job than generation has been submitted. Lock free, so it can be
+	// polled from every thread of a frame.
+	bool stale(unsigned long long generation) const;
+	// Jobs replaced before they started or finished after they went stale
+	unsigned long long droppedCount() const;
+
+protected:
+	// Loop run by the worker thread, waits for a job and runs it
+	void workerLoop();
+
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable job_ready;
+
+	// Job waiting to start
+	std::function<void(unsigned long long)> pending;
+	bool has_pending;
+	// Incremented for every job submitted, and the numbers of the one running and the last finished
+	std::atomic<unsigned long long> submitted;
+	unsigned long long running;
+	unsigned long long completed;
+	// Whether finished() has already reported completed
+	bool collected;
+	unsigned long long dropped;
+	bool stopping;
+};
@@ -0,0 +1,650 @@
+#include "SimdKernel.h"
+#include "MandelbrotKernel.h"
+#include "SimdTarget.h"
+
+// GCC would otherwise fuse the multiplies and adds in the AVX-512 function (AVX-512F implies
+// FMA) into FMAs, which round differently and stop the levels producing the same counts
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// Points per call into the point kernel from escape_time_row
+#define ROW_POINTS 256
+
+// Number of lanes set in a comparison mask
+static unsigned count_bits(unsigned bits)
+{
+	unsigned count = 0;
+	while (bits)
+	{
+		bits &= bits - 1;
+		count++;
+	}
+	return count;
+} // count_bits
+
+// Scalar fallback, for CPUs without AVX2
+static void escape_time_points_scalar(unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (in_cardioid_or_bulb(cx[i], cy[i]))
+		{
+			iterations[i] = max_iter;
+			stats.skipped++;
+		}
+		else if (period_tolerance > 0.0f)
+		{
+			unsigned saved;
+			iterations[i] = escape_time_periodic(cx[i], cy[i], max_iter, period_tolerance, saved);
+			if (saved > 0)
+			{
+				stats.periodic++;
+				stats.iterations_saved += saved;
+			}
+		}
+		else
+		{
+			iterations[i] = escape_time(cx[i], cy[i], max_iter);
+		}
+	}
+} // escape_time_points_scalar
+
+#if SIMD_X86
+// 8 points at a time, lanes drop out of the count once |z|^2 reaches 4. The last few points are
+// a partly masked vector: a scalar tail would cost the sum of their iterations, the vector only
+// the largest.
+SIMD_TARGET_AVX2
+static void escape_time_points_avx2(unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	const __m256 four = _mm256_set1_ps(4.0f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+	const __m256 sixteenth = _mm256_set1_ps(0.0625f);
+	const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+	const __m256 tolerance = _mm256_set1_ps(period_tolerance);
+	const __m256i max_count = _mm256_set1_epi32((int)max_iter);
+	const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const bool check_period = period_tolerance > 0.0f;
+
+	for (int i = 0; i < count; i += 8)
+	{
+		// Lanes past the last point load 0 (inside the cardioid) and are never iterated or stored
+		__m256i lanes = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), lane_index);
+		__m256 c_x = _mm256_maskload_ps(cx + i, lanes);
+		__m256 c_y = _mm256_maskload_ps(cy + i, lanes);
+
+		// Lanes inside the main cardioid or period-2 bulb start at max_iter and never iterate
+		__m256 xq = _mm256_sub_ps(c_x, quarter);
+		__m256 y2 = _mm256_mul_ps(c_y, c_y);
+		__m256 q = _mm256_add_ps(_mm256_mul_ps(xq, xq), y2);
+		__m256 in_cardioid = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xq)), _mm256_mul_ps(quarter, y2), _CMP_LT_OQ);
+		__m256 xb = _mm256_add_ps(c_x, one);
+		__m256 in_bulb = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(xb, xb), y2), sixteenth, _CMP_LT_OQ);
+		__m256 inside = _mm256_and_ps(_mm256_or_ps(in_cardioid, in_bulb), _mm256_castsi256_ps(lanes));
+		stats.skipped += count_bits(_mm256_movemask_ps(inside));
+
+		__m256 zx = _mm256_setzero_ps();
+		__m256 zy = _mm256_setzero_ps();
+		__m256i counts = _mm256_and_si256(_mm256_castps_si256(inside), max_count);
+		__m256 active = _mm256_andnot_ps(inside, _mm256_castsi256_ps(lanes));
+
+		// Brent's cycle detection, all lanes iterate in step so they share one schedule
+		__m256 saved_x = _mm256_setzero_ps();
+		__m256 saved_y = _mm256_setzero_ps();
+		unsigned period_limit = 1;
+		unsigned period_steps = 0;
+
+		for (unsigned n = 0; n < max_iter; n++)
+		{
+			__m256 zx2 = _mm256_mul_ps(zx, zx);
+			__m256 zy2 = _mm256_mul_ps(zy, zy);
+
+			// Compare |z|^2 against 4 rather than |z| against 2, no sqrt needed
+			active = _mm256_and_ps(active, _mm256_cmp_ps(_mm256_add_ps(zx2, zy2), four, _CMP_LT_OQ));
+			if (_mm256_movemask_ps(active) == 0)
+			{
+				break;
+			}
+			// Active lanes are all ones (-1), so subtracting adds 1 to just those lanes
+			counts = _mm256_sub_epi32(counts, _mm256_castps_si256(active));
+
+			__m256 zxzy = _mm256_mul_ps(zx, zy);
+			zy = _mm256_add_ps(_mm256_add_ps(zxzy, zxzy), c_y);
+			zx = _mm256_add_ps(_mm256_sub_ps(zx2, zy2), c_x);
+
+			if (check_period)
+			{
+				// Lanes back within tolerance of their saved point are in a cycle, finish them at max_iter
+				__m256 near_x = _mm256_cmp_ps(_mm256_andnot_ps(sign_bit, _mm256_sub_ps(zx, saved_x)), tolerance, _CMP_LT_OQ);
+				__m256 near_y = _mm256_cmp_ps(_mm256_andnot_ps(sign_bit, _mm256_sub_ps(zy, saved_y)), tolerance, _CMP_LT_OQ);
+				__m256 cycled = _mm256_and_ps(active, _mm256_and_ps(near_x, near_y));
+				int cycled_bits = _mm256_movemask_ps(cycled);
+				if (cycled_bits && n + 1 < max_iter)
+				{
+					unsigned cycled_count = count_bits(cycled_bits);
+					stats.periodic += cycled_count;
+					stats.iterations_saved += (unsigned long long)cycled_count * (max_iter - (n + 1));
+					counts = _mm256_blendv_epi8(counts, max_count, _mm256_castps_si256(cycled));
+					active = _mm256_andnot_ps(cycled, active);
+				}
+				if (++period_steps == period_limit)
+				{
+					saved_x = zx;
+					saved_y = zy;
+					period_steps = 0;
+					period_limit *= 2;
+				}
+			}
+		}
+
+		_mm256_maskstore_epi32((int*)(iterations + i), lanes, counts);
+	}
+} // escape_time_points_avx2
+
+// 8 points at a time. The lanes don't run in step: once half of them have finished, their counts
+// are written out and the next points moved in, so a few slow points (a border running along the
+// edge of the set) don't keep the rest of the vector idle. Moving points in and out goes through
+// memory, which is why it waits for half the lanes rather than doing it for each one.
+SIMD_TARGET_AVX2
+static void escape_time_streamed_avx2(unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	const __m256 four = _mm256_set1_ps(4.0f);
+	const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+	const __m256 tolerance = _mm256_set1_ps(period_tolerance);
+	const __m256i max_count = _mm256_set1_epi32((int)max_iter);
+	const __m256i lane_bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const bool check_period = period_tolerance > 0.0f;
+
+	// Each lane's point, its index (-1 once the count has been written) and where its orbit is.
+	// Zeroed because every lane is loaded each step, even the ones a short list never fills.
+	float lane_cx[8] = {}, lane_cy[8] = {}, lane_zx[8] = {}, lane_zy[8] = {}, lane_saved_x[8] = {}, lane_saved_y[8] = {};
+	int lane_index[8], lane_count[8] = {}, lane_steps[8] = {}, lane_limit[8] = {};
+	for (int k = 0; k < 8; k++)
+	{
+		lane_index[k] = -1;
+	}
+
+	int next = 0;
+	int active_bits = 0;
+	while (true)
+	{
+		// Write out the lanes that have finished and start the next points in them. Points inside
+		// the main cardioid or period-2 bulb are given max_iter without taking a lane.
+		for (int k = 0; k < 8; k++)
+		{
+			if (active_bits & (1 << k))
+			{
+				continue;
+			}
+			if (lane_index[k] >= 0)
+			{
+				iterations[lane_index[k]] = lane_count[k];
+				lane_index[k] = -1;
+			}
+			for (; next < count && lane_index[k] < 0; next++)
+			{
+				if (in_cardioid_or_bulb(cx[next], cy[next]))
+				{
+					iterations[next] = max_iter;
+					stats.skipped++;
+					continue;
+				}
+				lane_cx[k] = cx[next];
+				lane_cy[k] = cy[next];
+				lane_zx[k] = lane_zy[k] = 0.0f;
+				lane_saved_x[k] = lane_saved_y[k] = 0.0f;
+				lane_index[k] = next;
+				lane_count[k] = 0;
+				lane_steps[k] = 0;
+				lane_limit[k] = 1;
+				active_bits |= 1 << k;
+			}
+		}
+		if (active_bits == 0)
+		{
+			return;
+		}
+
+		__m256 c_x = _mm256_loadu_ps(lane_cx);
+		__m256 c_y = _mm256_loadu_ps(lane_cy);
+		__m256 zx = _mm256_loadu_ps(lane_zx);
+		__m256 zy = _mm256_loadu_ps(lane_zy);
+		__m256 saved_x = _mm256_loadu_ps(lane_saved_x);
+		__m256 saved_y = _mm256_loadu_ps(lane_saved_y);
+		__m256i counts = _mm256_loadu_si256((const __m256i*)lane_count);
+		__m256i period_steps = _mm256_loadu_si256((const __m256i*)lane_steps);
+		__m256i period_limit = _mm256_loadu_si256((const __m256i*)lane_limit);
+		__m256 active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(active_bits), lane_bit), lane_bit));
+
+		// Go back to refill once only half the lanes are busy, or once none are after the last point
+		int refill_below = next < count ? 5 : 1;
+		while (true)
+		{
+			__m256 zx2 = _mm256_mul_ps(zx, zx);
+			__m256 zy2 = _mm256_mul_ps(zy, zy);
+
+			// Compare |z|^2 against 4 rather than |z| against 2, no sqrt needed.
+			// A lane that has reached max_iter stops as well.
+			active = _mm256_and_ps(active, _mm256_cmp_ps(_mm256_add_ps(zx2, zy2), four, _CMP_LT_OQ));
+			active = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(counts, max_count)), active);
+			int bits = _mm256_movemask_ps(active);
+			if (bits != active_bits)
+			{
+				active_bits = bits;
+				if ((int)count_bits(bits) < refill_below)
+				{
+					break;
+				}
+			}
+			// Active lanes are all ones (-1), so subtracting adds 1 to just those lanes
+			counts = _mm256_sub_epi32(counts, _mm256_castps_si256(active));
+
+			__m256 zxzy = _mm256_mul_ps(zx, zy);
+			zy = _mm256_add_ps(_mm256_add_ps(zxzy, zxzy), c_y);
+			zx = _mm256_add_ps(_mm256_sub_ps(zx2, zy2), c_x);
+
+			if (check_period)
+			{
+				// Lanes back within tolerance of their saved point are in a cycle, finish them at
+				// max_iter. One that just reached max_iter saves nothing and finishes anyway.
+				__m256 near_x = _mm256_cmp_ps(_mm256_andnot_ps(sign_bit, _mm256_sub_ps(zx, saved_x)), tolerance, _CMP_LT_OQ);
+				__m256 near_y = _mm256_cmp_ps(_mm256_andnot_ps(sign_bit, _mm256_sub_ps(zy, saved_y)), tolerance, _CMP_LT_OQ);
+				__m256 cycled = _mm256_and_ps(active, _mm256_and_ps(near_x, near_y));
+				cycled = _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(counts, max_count)), cycled);
+				int cycled_bits = _mm256_movemask_ps(cycled);
+				if (cycled_bits)
+				{
+					int cycled_counts[8];
+					_mm256_storeu_si256((__m256i*)cycled_counts, counts);
+					for (int k = 0; k < 8; k++)
+					{
+						if (cycled_bits & (1 << k))
+						{
+							stats.periodic++;
+							stats.iterations_saved += max_iter - cycled_counts[k];
+						}
+					}
+					counts = _mm256_blendv_epi8(counts, max_count, _mm256_castps_si256(cycled));
+					active = _mm256_andnot_ps(cycled, active);
+				}
+
+				// Each lane moves its saved point on after 1, 2, 4, 8 ... of its own iterations
+				period_steps = _mm256_sub_epi32(period_steps, _mm256_castps_si256(active));
+				__m256i move = _mm256_and_si256(_mm256_castps_si256(active), _mm256_cmpeq_epi32(period_steps, period_limit));
+				saved_x = _mm256_blendv_ps(saved_x, zx, _mm256_castsi256_ps(move));
+				saved_y = _mm256_blendv_ps(saved_y, zy, _mm256_castsi256_ps(move));
+				period_steps = _mm256_andnot_si256(move, period_steps);
+				period_limit = _mm256_add_epi32(period_limit, _mm256_and_si256(move, period_limit));
+
+				if (cycled_bits)
+				{
+					active_bits = _mm256_movemask_ps(active);
+					if ((int)count_bits(active_bits) < refill_below)
+					{
+						break;
+					}
+				}
+			}
+		}
+
+		_mm256_storeu_ps(lane_zx, zx);
+		_mm256_storeu_ps(lane_zy, zy);
+		_mm256_storeu_ps(lane_saved_x, saved_x);
+		_mm256_storeu_ps(lane_saved_y, saved_y);
+		_mm256_storeu_si256((__m256i*)lane_count, counts);
+		_mm256_storeu_si256((__m256i*)lane_steps, period_steps);
+		_mm256_storeu_si256((__m256i*)lane_limit, period_limit);
+	}
+} // escape_time_streamed_avx2
+#endif
+
+#if SIMD_HAS_AVX512
+// 16 points at a time, escaped lanes are tracked in a mask register. The last few points are a
+// partly masked vector, like the AVX2 kernel.
+SIMD_TARGET_AVX512
+static void escape_time_points_avx512(unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	const __m512 four = _mm512_set1_ps(4.0f);
+	const __m512 one_f = _mm512_set1_ps(1.0f);
+	const __m512 quarter = _mm512_set1_ps(0.25f);
+	const __m512 sixteenth = _mm512_set1_ps(0.0625f);
+	const __m512 tolerance = _mm512_set1_ps(period_tolerance);
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i max_count = _mm512_set1_epi32((int)max_iter);
+	const bool check_period = period_tolerance > 0.0f;
+
+	for (int i = 0; i < count; i += 16)
+	{
+		// Lanes past the last point load 0 (inside the cardioid) and are never iterated or stored
+		__mmask16 lanes = count - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (count - i)) - 1);
+		__m512 c_x = _mm512_maskz_loadu_ps(lanes, cx + i);
+		__m512 c_y = _mm512_maskz_loadu_ps(lanes, cy + i);
+
+		// Lanes inside the main cardioid or period-2 bulb start at max_iter and never iterate
+		__m512 xq = _mm512_sub_ps(c_x, quarter);
+		__m512 y2 = _mm512_mul_ps(c_y, c_y);
+		__m512 q = _mm512_add_ps(_mm512_mul_ps(xq, xq), y2);
+		__mmask16 in_cardioid = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xq)), _mm512_mul_ps(quarter, y2), _CMP_LT_OQ);
+		__m512 xb = _mm512_add_ps(c_x, one_f);
+		__mmask16 in_bulb = _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(xb, xb), y2), sixteenth, _CMP_LT_OQ);
+		__mmask16 inside = (__mmask16)((in_cardioid | in_bulb) & lanes);
+		stats.skipped += count_bits(inside);
+
+		__m512 zx = _mm512_setzero_ps();
+		__m512 zy = _mm512_setzero_ps();
+		__m512i counts = _mm512_maskz_mov_epi32(inside, max_count);
+		__mmask16 active = (__mmask16)(lanes & ~inside);
+
+		// Brent's cycle detection, all lanes iterate in step so they share one schedule
+		__m512 saved_x = _mm512_setzero_ps();
+		__m512 saved_y = _mm512_setzero_ps();
+		unsigned period_limit = 1;
+		unsigned period_steps = 0;
+
+		for (unsigned n = 0; n < max_iter; n++)
+		{
+			__m512 zx2 = _mm512_mul_ps(zx, zx);
+			__m512 zy2 = _mm512_mul_ps(zy, zy);
+
+			active = _mm512_mask_cmp_ps_mask(active, _mm512_add_ps(zx2, zy2), four, _CMP_LT_OQ);
+			if (active == 0)
+			{
+				break;
+			}
+			counts = _mm512_mask_add_epi32(counts, active, counts, one);
+
+			__m512 zxzy = _mm512_mul_ps(zx, zy);
+			zy = _mm512_add_ps(_mm512_add_ps(zxzy, zxzy), c_y);
+			zx = _mm512_add_ps(_mm512_sub_ps(zx2, zy2), c_x);
+
+			if (check_period)
+			{
+				// Lanes back within tolerance of their saved point are in a cycle, finish them at max_iter
+				__mmask16 near_x = _mm512_mask_cmp_ps_mask(active, _mm512_abs_ps(_mm512_sub_ps(zx, saved_x)), tolerance, _CMP_LT_OQ);
+				__mmask16 cycled = _mm512_mask_cmp_ps_mask(near_x, _mm512_abs_ps(_mm512_sub_ps(zy, saved_y)), tolerance, _CMP_LT_OQ);
+				if (cycled && n + 1 < max_iter)
+				{
+					unsigned cycled_count = count_bits(cycled);
+					stats.periodic += cycled_count;
+					stats.iterations_saved += (unsigned long long)cycled_count * (max_iter - (n + 1));
+					counts = _mm512_mask_mov_epi32(counts, cycled, max_count);
+					active = (__mmask16)(active & ~cycled);
+				}
+				if (++period_steps == period_limit)
+				{
+					saved_x = zx;
+					saved_y = zy;
+					period_steps = 0;
+					period_limit *= 2;
+				}
+			}
+		}
+
+		_mm512_mask_storeu_epi32(iterations + i, lanes, counts);
+	}
+} // escape_time_points_avx512
+
+// The lowest count of the lanes set in bits
+static unsigned lowest_lanes(unsigned bits, int count)
+{
+	unsigned kept = 0;
+	for (; bits && count > 0; count--)
+	{
+		kept |= bits & (0u - bits);
+		bits &= bits - 1;
+	}
+	return kept;
+} // lowest_lanes
+
+// 16 points at a time, each lane moving on to the next point as soon as its own has finished:
+// the count is scattered straight to its place and the next points are expanded into the free
+// lanes, so a few slow points don't keep the rest of the vector idle
+SIMD_TARGET_AVX512
+static void escape_time_streamed_avx512(unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 four = _mm512_set1_ps(4.0f);
+	const __m512 one_f = _mm512_set1_ps(1.0f);
+	const __m512 quarter = _mm512_set1_ps(0.25f);
+	const __m512 sixteenth = _mm512_set1_ps(0.0625f);
+	const __m512 tolerance = _mm512_set1_ps(period_tolerance);
+	const __m512i zero_i = _mm512_setzero_si512();
+	const __m512i one = _mm512_set1_epi32(1);
+	const __m512i max_count = _mm512_set1_epi32((int)max_iter);
+	const __m512i lane_index = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const bool check_period = period_tolerance > 0.0f;
+
+	__m512 c_x = zero;
+	__m512 c_y = zero;
+	__m512 zx = zero;
+	__m512 zy = zero;
+	__m512i counts = zero_i;
+	__m512i index = zero_i;
+	// Brent's cycle detection, on a schedule of each lane's own
+	__m512 saved_x = zero;
+	__m512 saved_y = zero;
+	__m512i period_steps = zero_i;
+	__m512i period_limit = one;
+	__mmask16 active = 0;
+	int next = 0;
+
+	while (true)
+	{
+		// Start the next points in the idle lanes. Those inside the main cardioid or period-2
+		// bulb are given max_iter straight away and the lane is filled again.
+		while (active != 0xFFFF && next < count)
+		{
+			__mmask16 fill = (__mmask16)lowest_lanes((__mmask16)~active, count - next);
+			c_x = _mm512_mask_expandloadu_ps(c_x, fill, cx + next);
+			c_y = _mm512_mask_expandloadu_ps(c_y, fill, cy + next);
+			index = _mm512_mask_expand_epi32(index, fill, _mm512_add_epi32(lane_index, _mm512_set1_epi32(next)));
+			next += count_bits(fill);
+			zx = _mm512_mask_mov_ps(zx, fill, zero);
+			zy = _mm512_mask_mov_ps(zy, fill, zero);
+			saved_x = _mm512_mask_mov_ps(saved_x, fill, zero);
+			saved_y = _mm512_mask_mov_ps(saved_y, fill, zero);
+			counts = _mm512_mask_mov_epi32(counts, fill, zero_i);
+			period_steps = _mm512_mask_mov_epi32(period_steps, fill, zero_i);
+			period_limit = _mm512_mask_mov_epi32(period_limit, fill, one);
+
+			__m512 xq = _mm512_sub_ps(c_x, quarter);
+			__m512 y2 = _mm512_mul_ps(c_y, c_y);
+			__m512 q = _mm512_add_ps(_mm512_mul_ps(xq, xq), y2);
+			__mmask16 in_cardioid = _mm512_mask_cmp_ps_mask(fill, _mm512_mul_ps(q, _mm512_add_ps(q, xq)), _mm512_mul_ps(quarter, y2), _CMP_LT_OQ);
+			__m512 xb = _mm512_add_ps(c_x, one_f);
+			__mmask16 in_bulb = _mm512_mask_cmp_ps_mask(fill, _mm512_add_ps(_mm512_mul_ps(xb, xb), y2), sixteenth, _CMP_LT_OQ);
+			__mmask16 inside = in_cardioid | in_bulb;
+			if (inside)
+			{
+				stats.skipped += count_bits(inside);
+				_mm512_mask_i32scatter_epi32(iterations, inside, index, max_count, 4);
+			}
+			active = (__mmask16)(active | (fill & ~inside));
+		}
+		if (active == 0)
+		{
+			return;
+		}
+
+		__m512 zx2 = _mm512_mul_ps(zx, zx);
+		__m512 zy2 = _mm512_mul_ps(zy, zy);
+
+		// Lanes that have escaped or reached max_iter write their count out and free the lane
+		__mmask16 going = _mm512_mask_cmp_ps_mask(active, _mm512_add_ps(zx2, zy2), four, _CMP_LT_OQ);
+		going = _mm512_mask_cmpneq_epi32_mask(going, counts, max_count);
+		__mmask16 finished = (__mmask16)(active & ~going);
+		if (finished)
+		{
+			_mm512_mask_i32scatter_epi32(iterations, finished, index, counts, 4);
+			active = going;
+			continue;
+		}
+		counts = _mm512_mask_add_epi32(counts, active, counts, one);
+
+		__m512 zxzy = _mm512_mul_ps(zx, zy);
+		zy = _mm512_add_ps(_mm512_add_ps(zxzy, zxzy), c_y);
+		zx = _mm512_add_ps(_mm512_sub_ps(zx2, zy2), c_x);
+
+		if (check_period)
+		{
+			// Lanes back within tolerance of their saved point are in a cycle, finish them at
+			// max_iter. One that just reached max_iter saves nothing and finishes anyway.
+			__mmask16 near_x = _mm512_mask_cmp_ps_mask(active, _mm512_abs_ps(_mm512_sub_ps(zx, saved_x)), tolerance, _CMP_LT_OQ);
+			__mmask16 cycled = _mm512_mask_cmp_ps_mask(near_x, _mm512_abs_ps(_mm512_sub_ps(zy, saved_y)), tolerance, _CMP_LT_OQ);
+			cycled = _mm512_mask_cmpneq_epi32_mask(cycled, counts, max_count);
+			if (cycled)
+			{
+				unsigned cycled_counts[16];
+				_mm512_storeu_si512((void*)cycled_counts, counts);
+				for (int k = 0; k < 16; k++)
+				{
+					if (cycled & (1 << k))
+					{
+						stats.periodic++;
+						stats.iterations_saved += max_iter - cycled_counts[k];
+					}
+				}
+				_mm512_mask_i32scatter_epi32(iterations, cycled, index, max_count, 4);
+				active = (__mmask16)(active & ~cycled);
+			}
+
+			// Each lane moves its saved point on after 1, 2, 4, 8 ... of its own iterations
+			period_steps = _mm512_mask_add_epi32(period_steps, active, period_steps, one);
+			__mmask16 move = _mm512_mask_cmpeq_epi32_mask(active, period_steps, period_limit);
+			saved_x = _mm512_mask_mov_ps(saved_x, move, zx);
+			saved_y = _mm512_mask_mov_ps(saved_y, move, zy);
+			period_steps = _mm512_mask_mov_epi32(period_steps, move, zero_i);
+			period_limit = _mm512_mask_add_epi32(period_limit, move, period_limit, period_limit);
+		}
+	}
+} // escape_time_streamed_avx512
+#endif
+
+// Find the widest kernel this CPU and OS can run
+SimdLevel detect_simd_level()
+{
+#if SIMD_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return SIMD_SCALAR;
+	}
+
+	// The OS has to save the wider registers on a context switch (OSXSAVE + XCR0)
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx)
+	{
+		return SIMD_SCALAR;
+	}
+	unsigned long long xcr0 = _xgetbv(0);
+	bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+	bool zmm_enabled = (xcr0 & 0xE6) == 0xE6;
+
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	bool avx512f = (info[1] & (1 << 16)) != 0;
+
+#if SIMD_HAS_AVX512
+	if (avx512f && zmm_enabled)
+	{
+		return SIMD_AVX512;
+	}
+#endif
+	if (avx2 && ymm_enabled)
+	{
+		return SIMD_AVX2;
+	}
+#elif SIMD_X86
+	__builtin_cpu_init();
+#if SIMD_HAS_AVX512
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		return SIMD_AVX512;
+	}
+#endif
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return SIMD_AVX2;
+	}
+#endif
+	return SIMD_SCALAR;
+} // detect_simd_level
+
+const char* simd_level_name(SimdLevel level)
+{
+	switch (level)
+	{
+	case SIMD_AVX512:
+		return "AVX-512";
+	case SIMD_AVX2:
+		return "AVX2";
+	default:
+		return "Scalar";
+	}
+} // simd_level_name
+
+// Dispatch a list of points to the kernel for the requested instruction set
+void escape_time_points(SimdLevel level, unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+#if SIMD_HAS_AVX512
+	if (level == SIMD_AVX512)
+	{
+		escape_time_points_avx512(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+		return;
+	}
+#endif
+#if SIMD_X86
+	if (level >= SIMD_AVX2)
+	{
+		escape_time_points_avx2(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+		return;
+	}
+#endif
+	escape_time_points_scalar(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+} // escape_time_points
+
+// Dispatch a list of points to the lane-refilling kernel for the requested instruction set
+void escape_time_points_streamed(SimdLevel level, unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+#if SIMD_HAS_AVX512
+	if (level == SIMD_AVX512)
+	{
+		escape_time_streamed_avx512(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+		return;
+	}
+#endif
+#if SIMD_X86
+	if (level >= SIMD_AVX2)
+	{
+		escape_time_streamed_avx2(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+		return;
+	}
+#endif
+	escape_time_points_scalar(iterations, cx, cy, count, max_iter, period_tolerance, stats);
+} // escape_time_points_streamed
+
+// Work out the points along the row and pass them to the point kernel
+void escape_time_row(SimdLevel level, unsigned* iterations, int x0, int count, float left_, float span_x, unsigned w, float cy, unsigned max_iter, float period_tolerance, KernelStats& stats)
+{
+	float cxs[ROW_POINTS];
+	float cys[ROW_POINTS];
+	for (int i = 0; i < ROW_POINTS; i++)
+	{
+		cys[i] = cy;
+	}
+
+	for (int start = 0; start < count; start += ROW_POINTS)
+	{
+		int chunk = count - start < ROW_POINTS ? count - start : ROW_POINTS;
+		for (int i = 0; i < chunk; i++)
+		{
+			int x = x0 + start + i;
+			cxs[i] = left_ + (x * span_x / w);
+		}
+		escape_time_points(level, iterations + start, cxs, cys, chunk, max_iter, period_tolerance, stats);
+	}
+} // escape_time_row
@@ -0,0 +1,52 @@
+#pragma once
+
+// Vectorised escape-time kernels for the CPU backend.
+// The AVX2/AVX-512 paths are compiled in on x86 and picked at runtime,
+// everything else falls back to the scalar escape_time loop.
+#include <stdint.h>
+
+// Instruction sets the row kernel can run with, in order of preference
+enum SimdLevel
+{
+	SIMD_SCALAR = 0,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+// Query the CPU (and OS) for the widest instruction set we have a kernel for
+SimdLevel detect_simd_level();
+
+// Printable name of a SimdLevel, e.g. "AVX2"
+const char* simd_level_name(SimdLevel level);
+
+// What the kernels did besides iterating, added to by every call
+struct KernelStats
+{
+	// Points inside the main cardioid or period-2 bulb, never iterated
+	unsigned long long skipped;
+	// Points stopped early because their orbit repeated
+	unsigned long long periodic;
+	// Iterations those points would still have run before reaching max_iter
+	unsigned long long iterations_saved;
+	// Times a perturbed point was moved back to the start of the reference orbit (Perturbation.h)
+	unsigned long long rebased;
+};
+
+// Compute the iteration counts for count arbitrary points c = (cx[i], cy[i]).
+// Used where the pixels wanted aren't a run along one row, e.g. a column of a rectangle.
+// Points inside the main cardioid or period-2 bulb are given max_iter without iterating.
+// If period_tolerance is above 0, points whose orbit comes back within that distance of an
+// earlier point (Brent's cycle detection) are also given max_iter.
+void escape_time_points(SimdLevel level, unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats);
+
+// escape_time_points for long lists of points whose counts vary a lot, e.g. the borders the
+// Mariani-Silver mode iterates, which run along the edge of the set. The vector lanes don't
+// iterate in step: a lane whose point has finished moves on to the next point instead of idling
+// until the slowest lane is done. Gives the same counts, but costs more than escape_time_points
+// where most points finish within a few iterations.
+void escape_time_points_streamed(SimdLevel level, unsigned* iterations, const float* cx, const float* cy, int count, unsigned max_iter, float period_tolerance, KernelStats& stats);
+
+// Compute the iteration counts for count pixels of a single row, starting at pixel x0.
+// Pixel x maps to cx = left_ + (x * span_x / w), exactly as in the AMP kernels,
+// so every level produces the same counts as the scalar loop.
+void escape_time_row(SimdLevel level, unsigned* iterations, int x0, int count, float left_, float span_x, unsigned w, float cy, unsigned max_iter, float period_tolerance, KernelStats& stats);
@@ -0,0 +1,33 @@
+#pragma once
+
+// Compiler and platform switches shared by the files with vector code (SimdKernel.cpp,
+// Palette.cpp). Only included by .cpp files, the intrinsics headers stay out of everything else.
+
+// Only x86 has vector kernels, other targets always use the scalar loop
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define SIMD_X86 0
+#endif
+
+// AVX-512 intrinsics need Visual Studio 2017 15.3 or newer
+#if SIMD_X86 && (!defined(_MSC_VER) || _MSC_VER >= 1911)
+#define SIMD_HAS_AVX512 1
+#else
+#define SIMD_HAS_AVX512 0
+#endif
+
+// GCC and Clang need each vector function marked with the instruction set it uses,
+// so the rest of the program can still be built for a baseline CPU.
+// Visual Studio accepts the intrinsics without any extra flags.
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#endif
@@ -0,0 +1,319 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <new>
+
+// Nanoseconds to wait on a fence before giving up and writing anyway
+#define FENCE_TIMEOUT_NS 1000000000ull
+
+const char* upload_path_name(UploadPath path)
+{
+	switch (path)
+	{
+	case UPLOAD_PBO:
+		return "PBO";
+	case UPLOAD_PERSISTENT_PBO:
+		return "persistent PBO";
+	default:
+		return "glTexSubImage2D";
+	}
+} // upload_path_name
+
+TextureStreamer::TextureStreamer()
+{
+	gl = GLFunctions();
+	texture_id = 0;
+	supported_path = UPLOAD_CLIENT_MEMORY;
+	upload_path = UPLOAD_CLIENT_MEMORY;
+	image_width = 0;
+	image_height = 0;
+	origin_x = 0;
+	origin_y = 0;
+	uploaded_bytes = 0;
+	total_bytes = 0;
+	current = 0;
+	for (int i = 0; i < STREAM_BUFFERS; i++)
+	{
+		buffers[i] = 0;
+		mapped[i] = NULL;
+		fences[i] = NULL;
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	releaseBuffers();
+}
+
+// Persistent mapping needs buffer storage and fences, plain PBOs just buffers and map range
+void TextureStreamer::init(GLuint texture)
+{
+	texture_id = texture;
+	load_gl_functions(gl);
+
+	bool buffers_supported = gl.genBuffers && gl.deleteBuffers && gl.bindBuffer && gl.bufferData && gl.mapBufferRange && gl.unmapBuffer;
+	bool fences_supported = gl.fenceSync && gl.clientWaitSync && gl.deleteSync;
+	if (buffers_supported && gl.bufferStorage && fences_supported)
+	{
+		supported_path = UPLOAD_PERSISTENT_PBO;
+	}
+	else if (buffers_supported)
+	{
+		supported_path = UPLOAD_PBO;
+	}
+	else
+	{
+		supported_path = UPLOAD_CLIENT_MEMORY;
+	}
+	upload_path = supported_path;
+} // init
+
+// Reallocate the texture once, then a ring of buffers or the client image to fill it from
+void TextureStreamer::resize(int width, int height)
+{
+	if (width == image_width && height == image_height)
+	{
+		return;
+	}
+	releaseBuffers();
+	image_width = width;
+	image_height = height;
+	origin_x = 0;
+	origin_y = 0;
+
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	glTexImage2D(GL_TEXTURE_2D, 0, 4, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	upload_path = supported_path;
+	if (upload_path != UPLOAD_CLIENT_MEMORY)
+	{
+		// Clear anything left over so a failed allocation can be spotted
+		while (glGetError() != GL_NO_ERROR)
+		{
+		}
+
+		GLbitfield persistent_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		gl.genBuffers(STREAM_BUFFERS, buffers);
+		bool allocated = true;
+		for (int i = 0; i < STREAM_BUFFERS && allocated; i++)
+		{
+			gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[i]);
+			if (upload_path == UPLOAD_PERSISTENT_PBO)
+			{
+				gl.bufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferBytes(), NULL, persistent_flags);
+				mapped[i] = gl.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferBytes(), persistent_flags);
+				allocated = mapped[i] != NULL;
+			}
+			else
+			{
+				gl.bufferData(GL_PIXEL_UNPACK_BUFFER, bufferBytes(), NULL, GL_STREAM_DRAW);
+			}
+			allocated = allocated && glGetError() == GL_NO_ERROR;
+		}
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		// Not enough video memory at this size, copy from client memory instead
+		if (!allocated)
+		{
+			releaseBuffers();
+			upload_path = UPLOAD_CLIENT_MEMORY;
+		}
+	}
+
+	if (upload_path == UPLOAD_CLIENT_MEMORY)
+	{
+		// Make the next resize try again rather than think it has this size
+		try
+		{
+			image.resize(width, height);
+		}
+		catch (const std::bad_alloc&)
+		{
+			image_width = 0;
+			image_height = 0;
+			throw;
+		}
+	}
+	else
+	{
+		image.resize(0, 0);
+	}
+} // resize
+
+// Move on to the next buffer of the ring
+uint32_t* TextureStreamer::map(int& row_stride)
+{
+	row_stride = stride();
+	if (upload_path == UPLOAD_CLIENT_MEMORY)
+	{
+		return image.data();
+	}
+
+	current = (current + 1) % STREAM_BUFFERS;
+	if (upload_path == UPLOAD_PERSISTENT_PBO)
+	{
+		// Three frames on, the copy out of this buffer has almost always finished already
+		if (fences[current] != NULL)
+		{
+			gl.clientWaitSync(fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+			gl.deleteSync(fences[current]);
+			fences[current] = NULL;
+		}
+		return (uint32_t*)mapped[current];
+	}
+
+	// Invalidating lets the driver hand over fresh memory instead of waiting for the GPU
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[current]);
+	void* memory = gl.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferBytes(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return (uint32_t*)memory;
+} // map
+
+// Each rectangle is moved by the origin, and split where that takes it past the right or
+// bottom of the texture
+void TextureStreamer::upload(const std::vector<Tile>& rects)
+{
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	// Rows in the buffer are stride pixels apart, not the image width
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride());
+	const uint32_t* data = NULL;
+	if (upload_path == UPLOAD_CLIENT_MEMORY)
+	{
+		data = image.data();
+	}
+	else
+	{
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[current]);
+		if (upload_path == UPLOAD_PBO)
+		{
+			gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	}
+
+	uploaded_bytes = 0;
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		const Tile& r = rects[i];
+		if (r.width <= 0 || r.height <= 0)
+		{
+			continue;
+		}
+		int x = (r.x + origin_x) % image_width;
+		int y = (r.y + origin_y) % image_height;
+		int left_width = std::min(r.width, image_width - x);
+		int top_height = std::min(r.height, image_height - y);
+		uploadPiece(data, r.x, r.y, x, y, left_width, top_height);
+		if (left_width < r.width)
+		{
+			uploadPiece(data, r.x + left_width, r.y, 0, y, r.width - left_width, top_height);
+		}
+		if (top_height < r.height)
+		{
+			uploadPiece(data, r.x, r.y + top_height, x, 0, left_width, r.height - top_height);
+		}
+		if (left_width < r.width && top_height < r.height)
+		{
+			uploadPiece(data, r.x + left_width, r.y + top_height, 0, 0, r.width - left_width, r.height - top_height);
+		}
+	}
+	total_bytes += uploaded_bytes;
+
+	if (upload_path != UPLOAD_CLIENT_MEMORY)
+	{
+		if (upload_path == UPLOAD_PERSISTENT_PBO)
+		{
+			fences[current] = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+} // upload
+
+// The texel a pixel is in moves with it, so the origin moves by the pan
+void TextureStreamer::scroll(int dx, int dy)
+{
+	if (image_width == 0 || image_height == 0)
+	{
+		return;
+	}
+	origin_x = ((origin_x + dx) % image_width + image_width) % image_width;
+	origin_y = ((origin_y + dy) % image_height + image_height) % image_height;
+} // scroll
+
+float TextureStreamer::originU() const
+{
+	return image_width > 0 ? (float)origin_x / image_width : 0.0f;
+} // originU
+
+float TextureStreamer::originV() const
+{
+	return image_height > 0 ? (float)origin_y / image_height : 0.0f;
+} // originV
+
+int TextureStreamer::width() const
+{
+	return image_width;
+} // width
+
+int TextureStreamer::height() const
+{
+	return image_height;
+} // height
+
+UploadPath TextureStreamer::path() const
+{
+	return upload_path;
+} // path
+
+size_t TextureStreamer::uploadedBytes() const
+{
+	return uploaded_bytes;
+} // uploadedBytes
+
+unsigned long long TextureStreamer::totalBytes() const
+{
+	return total_bytes;
+} // totalBytes
+
+void TextureStreamer::releaseBuffers()
+{
+	for (int i = 0; i < STREAM_BUFFERS; i++)
+	{
+		if (fences[i] != NULL)
+		{
+			gl.deleteSync(fences[i]);
+			fences[i] = NULL;
+		}
+		// Deleting a buffer unmaps it
+		mapped[i] = NULL;
+	}
+	if (buffers[0] != 0)
+	{
+		gl.deleteBuffers(STREAM_BUFFERS, buffers);
+		for (int i = 0; i < STREAM_BUFFERS; i++)
+		{
+			buffers[i] = 0;
+		}
+	}
+} // releaseBuffers
+
+// Rows padded like a FrameBuffer's, so the colour pass writes whole cache lines
+int TextureStreamer::stride() const
+{
+	return (int)((image_width + FRAME_STRIDE_PIXELS - 1) / FRAME_STRIDE_PIXELS * FRAME_STRIDE_PIXELS);
+} // stride
+
+size_t TextureStreamer::bufferBytes() const
+{
+	return (size_t)stride() * image_height * sizeof(uint32_t);
+} // bufferBytes
+
+// The skips pick the rectangle out of the rows, with a pixel buffer bound data is an offset into it
+void TextureStreamer::uploadPiece(const uint32_t* data, int src_x, int src_y, int dst_x, int dst_y, int width, int height)
+{
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, src_x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, src_y);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, dst_x, dst_y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+	uploaded_bytes += (size_t)width * height * sizeof(uint32_t);
+} // uploadPiece
@@ -0,0 +1,100 @@
+#pragma once
+
+// Streams coloured frames into the texture the window is drawn with.
+#include <vector>
+#include "GLFunctions.h"
+#include "FrameBuffer.h"
+#include "TileScheduler.h"
+
+// Pixel buffers in the ring, the GPU can still be reading the last ones while the next is written
+#define STREAM_BUFFERS 3
+
+// How the image reaches the texture, the best the driver supports
+enum UploadPath
+{
+	// glTexSubImage2D straight from client memory (OpenGL 1.1)
+	UPLOAD_CLIENT_MEMORY,
+	// Pixel buffer objects mapped for each frame (3.0)
+	UPLOAD_PBO,
+	// Pixel buffer objects mapped once and kept mapped (4.4 / ARB_buffer_storage)
+	UPLOAD_PERSISTENT_PBO
+};
+
+// Display name of an upload path, for the HUD
+const char* upload_path_name(UploadPath path);
+
+// TextureStreamer class
+// Owns the memory a frame is coloured into and copies it to a texture allocated once per
+// resolution, with glTexSubImage2D rather than reallocating it every frame. With pixel buffer
+// objects the colour pass writes into memory the driver can DMA from, so the copy happens on the
+// GPU's time and upload() returns straight away. A ring of STREAM_BUFFERS means the next frame
+// is written into a buffer the GPU has finished with, a fence on each makes sure of it.
+// Only the rectangles of the image that changed are copied. The texture wraps round (GL_REPEAT)
+// from an origin that a pan moves, so the part of the image still in view stays where it is and
+// only the strips the pan uncovered are uploaded.
+class TextureStreamer
+{
+public:
+	TextureStreamer();
+	~TextureStreamer();
+
+	// Load the entry points and choose the upload path, needs the GL context to be current
+	void init(GLuint texture);
+
+	// Allocate the texture and buffers for a width x height image, only when the size has changed.
+	// Throws std::bad_alloc if the client memory path can't get the memory.
+	void resize(int width, int height);
+
+	// Memory to write the next image into, stride pixels per row. Waits for the GPU to be done
+	// with the buffer if it is still being read from STREAM_BUFFERS frames ago.
+	uint32_t* map(int& stride);
+	// Copy rectangles of the image written since map() into the texture, the rest of the buffer
+	// needn't have been written
+	void upload(const std::vector<Tile>& rects);
+	// Move the image by whole pixels without uploading it again: pixel (x, y) shows what
+	// (x + dx, y + dy) did. The strips that uncovers still have to be uploaded.
+	void scroll(int dx, int dy);
+
+	// Texture coordinates of the image's top-left pixel, to draw it from
+	float originU() const;
+	float originV() const;
+
+	int width() const;
+	int height() const;
+	UploadPath path() const;
+	// Bytes the last upload copied, and every upload since the program started
+	size_t uploadedBytes() const;
+	unsigned long long totalBytes() const;
+
+protected:
+	// Delete the buffers and fences, and unmap them
+	void releaseBuffers();
+	// Pixels from one row to the next in every buffer
+	int stride() const;
+	size_t bufferBytes() const;
+	// Copy a rectangle at src_x, src_y in the image to dst_x, dst_y in the texture, from data
+	// (or the bound buffer when it is NULL)
+	void uploadPiece(const uint32_t* data, int src_x, int src_y, int dst_x, int dst_y, int width, int height);
+
+	GLFunctions gl;
+	GLuint texture_id;
+	// Best path the driver supports, and the one in use for this size (lower if the buffers
+	// couldn't be allocated)
+	UploadPath supported_path;
+	UploadPath upload_path;
+	int image_width, image_height;
+	// Texel the image's top-left pixel is in
+	int origin_x, origin_y;
+	size_t uploaded_bytes;
+	unsigned long long total_bytes;
+
+	GLuint buffers[STREAM_BUFFERS];
+	// Persistently mapped memory of each buffer
+	void* mapped[STREAM_BUFFERS];
+	// Set after each upload from a buffer, waited on before it is written again
+	GLsync fences[STREAM_BUFFERS];
+	int current;
+
+	// Image for the client memory path
+	FrameBuffer image;
+};
@@ -0,0 +1,112 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+	task_ = nullptr;
+	task_count_ = 0;
+	next_index_ = 0;
+	active_workers_ = 0;
+	generation_ = 0;
+	stopping_ = false;
+
+	if (thread_count == 0)
+	{
+		thread_count = std::thread::hardware_concurrency();
+	}
+	if (thread_count == 0)
+	{
+		thread_count = 1;
+	}
+
+	// The thread calling parallel_for also does work, so spawn one fewer
+	for (unsigned i = 1; i < thread_count; i++)
+	{
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(job_mutex);
+		stopping_ = true;
+	}
+	work_ready.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+}
+
+// Run task over [0, count) on every thread and wait for it to finish
+void ThreadPool::parallel_for(int count, const std::function<void(int)>& task)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> submit_lock(submit_mutex);
+
+	std::unique_lock<std::mutex> lock(job_mutex);
+	task_ = &task;
+	task_count_ = count;
+	next_index_ = 0;
+	active_workers_ = (unsigned)workers.size();
+	++generation_;
+	lock.unlock();
+	work_ready.notify_all();
+
+	// Help out rather than sitting idle
+	runTasks();
+
+	lock.lock();
+	work_done.wait(lock, [this] { return active_workers_ == 0; });
+	task_ = nullptr;
+} // parallel_for
+
+unsigned ThreadPool::size() const
+{
+	return (unsigned)workers.size() + 1;
+} // size
+
+// Wait for jobs and work on them until the pool is destroyed
+void ThreadPool::workerLoop()
+{
+	unsigned long long seen_generation = 0;
+
+	for (;;)
+	{
+		std::unique_lock<std::mutex> lock(job_mutex);
+		work_ready.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+		if (stopping_)
+		{
+			return;
+		}
+		seen_generation = generation_;
+		lock.unlock();
+
+		runTasks();
+
+		lock.lock();
+		if (--active_workers_ == 0)
+		{
+			work_done.notify_one();
+		}
+	}
+} // workerLoop
+
+// Claim indices one at a time from the shared counter
+void ThreadPool::runTasks()
+{
+	for (;;)
+	{
+		int i = next_index_.fetch_add(1);
+		if (i >= task_count_)
+		{
+			break;
+		}
+		(*task_)(i);
+	}
+} // runTasks
@@ -0,0 +1,53 @@
+#pragma once
+
+// Standard library only, so the CPU backend builds without AMP or GLUT.
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ThreadPool class
+// Fixed set of worker threads, created once and reused for every frame.
+// parallel_for hands out indices from a shared counter, so a slow row (lots of
+// pixels inside the set) doesn't hold up the rest of the frame.
+class ThreadPool
+{
+public:
+	// thread_count of 0 uses one thread per hardware thread
+	ThreadPool(unsigned thread_count = 0);
+	~ThreadPool();
+
+	// Runs task(i) for every i in [0, count) across the pool, the calling thread included.
+	// Blocks until every index has been processed.
+	void parallel_for(int count, const std::function<void(int)>& task);
+
+	// Number of threads that work on a parallel_for (workers plus the caller)
+	unsigned size() const;
+
+protected:
+	// Loop run by each worker, waits for a new job and then pulls indices from it
+	void workerLoop();
+	// Pulls indices from the current job until none are left
+	void runTasks();
+
+	std::vector<std::thread> workers;
+
+	// Serialises callers of parallel_for so only one job is in flight at a time
+	std::mutex submit_mutex;
+	// Guards the job description below
+	std::mutex job_mutex;
+	std::condition_variable work_ready;
+	std::condition_variable work_done;
+
+	// Current job
+	const std::function<void(int)>* task_;
+	int task_count_;
+	std::atomic<int> next_index_;
+	// Workers that have not yet finished the current job
+	unsigned active_workers_;
+	// Incremented for every job so workers can tell a new one has arrived
+	unsigned long long generation_;
+	bool stopping_;
+};
@@ -0,0 +1,163 @@
+#include "TileCache.h"
+#include <cmath>
+#include <string.h>
+
+// Bytes one tile's counts take up, what the memory cap is measured in
+#define TILE_BYTES ((size_t)CACHE_TILE * CACHE_TILE * sizeof(unsigned))
+
+TileCache::TileCache(size_t max_bytes)
+{
+	capacity = max_bytes;
+	next_grid = 0;
+	hit_count = 0;
+	miss_count = 0;
+}
+
+void TileCache::setCapacity(size_t max_bytes)
+{
+	capacity = max_bytes;
+	evict(0);
+} // setCapacity
+
+void TileCache::clear()
+{
+	lru.clear();
+	index.clear();
+	grids.clear();
+} // clear
+
+// Find a grid of the same pixel size that the view's pixels line up with, or anchor a new one on it
+unsigned TileCache::grid(const Viewport& view, int width, int height, long long& origin_x, long long& origin_y)
+{
+	double span_x = view.right_ - view.left_;
+	double span_y = view.bottom_ - view.top_;
+	double pixel_x = span_x / width;
+	double pixel_y = span_y / height;
+
+	for (size_t i = 0; i < grids.size(); i++)
+	{
+		const Grid& g = grids[i];
+		if (g.width != width || g.height != height || g.span_x != span_x || g.span_y != span_y)
+		{
+			continue;
+		}
+		// The difference is exact in fixed point, only the division rounds
+		double offset_x = to_double(view.x - g.anchor_x) / pixel_x;
+		double offset_y = to_double(view.y - g.anchor_y) / pixel_y;
+		if (std::fabs(offset_x) > CACHE_MAX_OFFSET || std::fabs(offset_y) > CACHE_MAX_OFFSET)
+		{
+			continue;
+		}
+		// Within a thousandth of a pixel is the same point, pans are whole pixels added in double
+		long long whole_x = std::llround(offset_x);
+		long long whole_y = std::llround(offset_y);
+		if (std::fabs(offset_x - whole_x) < 1e-3 && std::fabs(offset_y - whole_y) < 1e-3)
+		{
+			origin_x = whole_x;
+			origin_y = whole_y;
+			return g.id;
+		}
+	}
+
+	if (grids.size() >= CACHE_GRIDS)
+	{
+		grids.erase(grids.begin());
+	}
+	Grid g;
+	g.id = next_grid++;
+	g.width = width;
+	g.height = height;
+	g.span_x = span_x;
+	g.span_y = span_y;
+	g.anchor_x = view.x;
+	g.anchor_y = view.y;
+	grids.push_back(g);
+	origin_x = 0;
+	origin_y = 0;
+	return g.id;
+} // grid
+
+// Copy the part out if the cached tile covers it, and make it the most recently used
+bool TileCache::lookup(const TileKey& key, const Tile& part, unsigned* counts, int stride)
+{
+	std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash>::iterator found = index.find(key);
+	if (found == index.end())
+	{
+		miss_count++;
+		return false;
+	}
+	const Entry& entry = *found->second;
+	const Tile& valid = entry.valid;
+	if (part.x < valid.x || part.y < valid.y || part.x + part.width > valid.x + valid.width || part.y + part.height > valid.y + valid.height)
+	{
+		miss_count++;
+		return false;
+	}
+
+	for (int y = 0; y < part.height; y++)
+	{
+		memcpy(counts + (size_t)y * stride, &entry.counts[(size_t)(part.y + y) * CACHE_TILE + part.x], part.width * sizeof(unsigned));
+	}
+	lru.splice(lru.begin(), lru, found->second);
+	hit_count++;
+	return true;
+} // lookup
+
+// Copy the part in, reusing the tile's memory if it is already held
+void TileCache::store(const TileKey& key, const Tile& part, const unsigned* counts, int stride)
+{
+	std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash>::iterator found = index.find(key);
+	if (found != index.end())
+	{
+		lru.splice(lru.begin(), lru, found->second);
+	}
+	else
+	{
+		evict(TILE_BYTES);
+		if (TILE_BYTES > capacity)
+		{
+			return;
+		}
+		lru.push_front(Entry());
+		lru.front().key = key;
+		lru.front().counts.resize((size_t)CACHE_TILE * CACHE_TILE);
+		index[key] = lru.begin();
+	}
+
+	Entry& entry = lru.front();
+	entry.valid = part;
+	for (int y = 0; y < part.height; y++)
+	{
+		memcpy(&entry.counts[(size_t)(part.y + y) * CACHE_TILE + part.x], counts + (size_t)y * stride, part.width * sizeof(unsigned));
+	}
+} // store
+
+long long TileCache::hits() const
+{
+	return hit_count;
+} // hits
+
+long long TileCache::misses() const
+{
+	return miss_count;
+} // misses
+
+size_t TileCache::entries() const
+{
+	return lru.size();
+} // entries
+
+size_t TileCache::bytes() const
+{
+	return lru.size() * TILE_BYTES;
+} // bytes
+
+// Least recently used are at the back
+void TileCache::evict(size_t extra)
+{
+	while (!lru.empty() && bytes() + extra > capacity)
+	{
+		index.erase(lru.back().key);
+		lru.pop_back();
+	}
+} // evict
@@ -0,0 +1,124 @@
+#pragma once
+
+// Cache of computed iteration counts, standard library only like the CPU backend it feeds.
+#include <list>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+#include "FixedPoint.h"
+#include "PrecisionKernel.h"
+#include "TileScheduler.h"
+#include "Viewport.h"
+
+// Edge of a cached tile in pixels
+#define CACHE_TILE 64
+// Memory the cached counts may take up by default
+#define TILE_CACHE_MB 256
+// Grids remembered at once, the oldest is forgotten (and its tiles age out) past this
+#define CACHE_GRIDS 64
+// Frames whose centres are further apart than this many pixels aren't put on the same grid,
+// past it the offset can't be told to the nearest pixel in double
+#define CACHE_MAX_OFFSET 1e12
+
+// TileKey struct
+// One tile of one grid (TileCache::grid), in columns and rows of CACHE_TILE pixels, computed
+// with a particular maximum number of iterations, cycle detection setting and number type.
+// The series approximation changes the counts of perturbation tiles a little, so it is part of the key too.
+struct TileKey
+{
+	unsigned grid;
+	long long column, row;
+	unsigned max_iter;
+	bool periodicity_check;
+	// The precision the frame was actually iterated in, never PRECISION_AUTO
+	Precision precision;
+	bool series_approximation;
+};
+
+inline bool operator==(const TileKey& a, const TileKey& b)
+{
+	return a.grid == b.grid && a.column == b.column && a.row == b.row && a.max_iter == b.max_iter
+		&& a.periodicity_check == b.periodicity_check && a.precision == b.precision
+		&& a.series_approximation == b.series_approximation;
+} // operator==
+
+struct TileKeyHash
+{
+	size_t operator()(const TileKey& key) const
+	{
+		size_t hash = key.grid;
+		hash = hash * 1000003u ^ (size_t)key.column;
+		hash = hash * 1000003u ^ (size_t)key.row;
+		hash = hash * 1000003u ^ key.max_iter;
+		hash = hash * 1000003u ^ (size_t)key.precision;
+		hash = hash * 2u + (key.periodicity_check ? 1u : 0u);
+		return hash * 2u + (key.series_approximation ? 1u : 0u);
+	}
+};
+
+// TileCache class
+// Least recently used cache of CACHE_TILE x CACHE_TILE tiles of iteration counts.
+// Tiles are laid out on a grid of the complex plane rather than of a frame: every frame with
+// the same pixel size whose centre is a whole number of pixels from the grid's anchor puts
+// its pixels on the same points, so a view that is panned or zoomed back to finds the tiles it
+// computed before. A tile at the edge of a frame only holds the part that was in it.
+// Not thread safe, the render worker is the only one to use it.
+class TileCache
+{
+public:
+	TileCache(size_t max_bytes = (size_t)TILE_CACHE_MB * 1024 * 1024);
+
+	// Memory cap, evicts down to it straight away
+	void setCapacity(size_t max_bytes);
+	// Forget every tile and grid
+	void clear();
+
+	// The grid a width x height frame of view lies on, made if there isn't one yet, and the
+	// grid position of the frame's pixel (0, 0). Pixel (x, y) is at (origin_x + x, origin_y + y).
+	unsigned grid(const Viewport& view, int width, int height, long long& origin_x, long long& origin_y);
+
+	// Copy part (in pixels from the tile's top-left) of a cached tile into counts, which holds
+	// part's top-left pixel and is stride pixels per row. False if the tile isn't there or
+	// holds less than part.
+	bool lookup(const TileKey& key, const Tile& part, unsigned* counts, int stride);
+	// Keep part of a tile, replacing whatever was held for it
+	void store(const TileKey& key, const Tile& part, const unsigned* counts, int stride);
+
+	// Lookups that found their tile and those that didn't, since the cache was made
+	long long hits() const;
+	long long misses() const;
+	// Tiles held, and the memory their counts take up
+	size_t entries() const;
+	size_t bytes() const;
+
+protected:
+	// Tiles of one frame size and pixel spacing whose pixels line up with the anchor
+	struct Grid
+	{
+		unsigned id;
+		int width, height;
+		double span_x, span_y;
+		FixedPoint anchor_x, anchor_y;
+	};
+
+	struct Entry
+	{
+		TileKey key;
+		// Part of the tile that holds counts
+		Tile valid;
+		std::vector<unsigned> counts;
+	};
+
+	// Drop the least recently used tiles until there is room for extra more bytes
+	void evict(size_t extra);
+
+	// Most recently used first
+	std::list<Entry> lru;
+	std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> index;
+	std::vector<Grid> grids;
+	unsigned next_grid;
+
+	size_t capacity;
+	long long hit_count;
+	long long miss_count;
+};
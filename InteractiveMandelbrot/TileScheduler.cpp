@@ -0,0 +1,166 @@
+#include "TileScheduler.h"
+#include <chrono>
+
+typedef std::chrono::steady_clock the_tile_clock;
+
+TileScheduler::TileScheduler(ThreadPool& thread_pool) : pool(thread_pool)
+{
+	stealing_enabled = true;
+	steals = 0;
+}
+
+TileScheduler::~TileScheduler()
+{
+}
+
+void TileScheduler::setStealing(bool enabled)
+{
+	stealing_enabled = enabled;
+} // setStealing
+
+bool TileScheduler::stealing() const
+{
+	return stealing_enabled;
+} // stealing
+
+// Split the frame into tiles, deal them out and run them with stealing
+void TileScheduler::run(int width, int height, int tile_size, const std::function<void(const Tile&)>& task)
+{
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+	if (tile_size < 1)
+	{
+		tile_size = 1;
+	}
+
+	// Row-major list of tiles, clipped at the right and bottom edges
+	tiles.clear();
+	for (int y = 0; y < height; y += tile_size)
+	{
+		for (int x = 0; x < width; x += tile_size)
+		{
+			Tile t;
+			t.x = x;
+			t.y = y;
+			t.width = width - x < tile_size ? width - x : tile_size;
+			t.height = height - y < tile_size ? height - y : tile_size;
+			tiles.push_back(t);
+		}
+	}
+
+	// Each worker gets a contiguous run of tiles, i.e. a horizontal band of the frame
+	unsigned worker_count = pool.size();
+	while (queues.size() < worker_count)
+	{
+		queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+	}
+	int tile_count = (int)tiles.size();
+	for (unsigned w = 0; w < worker_count; w++)
+	{
+		int first = (int)((long long)tile_count * w / worker_count);
+		int last = (int)((long long)tile_count * (w + 1) / worker_count);
+		queues[w]->tiles.clear();
+		for (int i = first; i < last; i++)
+		{
+			queues[w]->tiles.push_back(i);
+		}
+	}
+
+	timings.assign(tiles.size(), TileTiming());
+	worker_busy_ns.assign(worker_count, 0);
+	steals = 0;
+
+	the_tile_clock::time_point frame_start = the_tile_clock::now();
+
+	pool.parallel_for(worker_count, [&](int worker)
+	{
+		int tile_index;
+		while (popLocal(worker, tile_index) || (stealing_enabled && steal(worker, tile_index)))
+		{
+			the_tile_clock::time_point start = the_tile_clock::now();
+
+			task(tiles[tile_index]);
+
+			the_tile_clock::time_point end = the_tile_clock::now();
+
+			TileTiming& timing = timings[tile_index];
+			timing.tile = tiles[tile_index];
+			timing.worker = worker;
+			timing.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - frame_start).count();
+			timing.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+			worker_busy_ns[worker] += timing.duration_ns;
+		}
+	});
+} // run
+
+const std::vector<TileTiming>& TileScheduler::tileTimings() const
+{
+	return timings;
+} // tileTimings
+
+const std::vector<long long>& TileScheduler::workerBusyTimes() const
+{
+	return worker_busy_ns;
+} // workerBusyTimes
+
+unsigned TileScheduler::stealCount() const
+{
+	return steals;
+} // stealCount
+
+// Compare the busiest worker with the average, shows how much time the others sat idle
+float TileScheduler::imbalance() const
+{
+	long long total = 0;
+	long long busiest = 0;
+	for (size_t i = 0; i < worker_busy_ns.size(); i++)
+	{
+		total += worker_busy_ns[i];
+		if (worker_busy_ns[i] > busiest)
+		{
+			busiest = worker_busy_ns[i];
+		}
+	}
+	if (total == 0)
+	{
+		return 1.0f;
+	}
+	double mean = (double)total / worker_busy_ns.size();
+	return (float)(busiest / mean);
+} // imbalance
+
+// The owner works from the back of its deque
+bool TileScheduler::popLocal(unsigned worker, int& tile_index)
+{
+	WorkerQueue& queue = *queues[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tiles.empty())
+	{
+		return false;
+	}
+	tile_index = queue.tiles.back();
+	queue.tiles.pop_back();
+	return true;
+} // popLocal
+
+// Thieves take from the front, furthest away from where the owner is working
+bool TileScheduler::steal(unsigned thief, int& tile_index)
+{
+	unsigned worker_count = (unsigned)worker_busy_ns.size();
+	for (unsigned i = 1; i < worker_count; i++)
+	{
+		WorkerQueue& victim = *queues[(thief + i) % worker_count];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tiles.empty())
+		{
+			tile_index = victim.tiles.front();
+			victim.tiles.pop_front();
+			++steals;
+			return true;
+		}
+	}
+	// Nothing left anywhere, no new tiles are ever added during a run
+	return false;
+} // steal
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ThreadPool.h"
+
+// Rectangle of pixels handed to a worker as one unit of work
+struct Tile
+{
+	int x, y;
+	int width, height;
+};
+
+// How long a tile took and which worker ran it
+struct TileTiming
+{
+	Tile tile;
+	unsigned worker;
+	// Nanoseconds since the start of the frame
+	long long start_ns;
+	long long duration_ns;
+};
+
+// TileScheduler class
+// Splits a frame into small tiles and runs them on the thread pool.
+// Each worker starts with a contiguous block of tiles in its own deque (the same split
+// a static row partition would give), works through it from the back, and once empty
+// steals from the front of another worker's deque. Interior pixels cost MAX_ITERATIONS
+// and exterior ones a handful, so without stealing the workers given the set finish last.
+class TileScheduler
+{
+public:
+	TileScheduler(ThreadPool& thread_pool);
+	~TileScheduler();
+
+	// Turn stealing off to get the static split for comparison
+	void setStealing(bool enabled);
+	bool stealing() const;
+
+	// Split a width x height frame into tile_size squares and run task on every one.
+	// Blocks until the whole frame is done.
+	void run(int width, int height, int tile_size, const std::function<void(const Tile&)>& task);
+
+	// Results of the last run
+	const std::vector<TileTiming>& tileTimings() const;
+	const std::vector<long long>& workerBusyTimes() const;
+	unsigned stealCount() const;
+	// Busiest worker's time divided by the mean, 1.0 is perfectly balanced
+	float imbalance() const;
+
+protected:
+	// Tiles waiting to be run by one worker, guarded by its own lock
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<int> tiles;
+	};
+
+	// Take the next tile from the back of this worker's own deque
+	bool popLocal(unsigned worker, int& tile_index);
+	// Take a tile from the front of another worker's deque
+	bool steal(unsigned thief, int& tile_index);
+
+	ThreadPool& pool;
+	bool stealing_enabled;
+
+	std::vector<Tile> tiles;
+	std::vector<std::unique_ptr<WorkerQueue> > queues;
+
+	std::vector<TileTiming> timings;
+	std::vector<long long> worker_busy_ns;
+	std::atomic<unsigned> steals;
+};
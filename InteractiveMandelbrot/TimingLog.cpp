@@ -0,0 +1,107 @@
+#include "TimingLog.h"
+#include <vector>
+
+TimingLog::TimingLog()
+{
+	format = TIMING_CSV;
+	stopping = false;
+	dropped = 0;
+}
+
+TimingLog::~TimingLog()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	record_ready.notify_all();
+	if (writer.joinable())
+	{
+		writer.join();
+	}
+}
+
+// The header goes out before the writer starts, so nothing else is using the file yet
+bool TimingLog::open(const std::string& path)
+{
+	const std::string extension = ".jsonl";
+	bool json = path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+	format = json ? TIMING_JSON_LINES : TIMING_CSV;
+
+	file.open(path.c_str());
+	if (!file)
+	{
+		return false;
+	}
+	if (format == TIMING_CSV)
+	{
+		file << "timestamp_ms,width,height,max_iterations,backend,tile_size,input_ns,compute_ns,colour_ns,upload_ns\n";
+	}
+	writer = std::thread(&TimingLog::writerLoop, this);
+	return true;
+} // open
+
+bool TimingLog::log(const TimingRecord& record)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!writer.joinable() || queue.size() >= TIMING_LOG_QUEUE)
+		{
+			++dropped;
+			return false;
+		}
+		queue.push_back(record);
+	}
+	record_ready.notify_one();
+	return true;
+} // log
+
+unsigned long long TimingLog::droppedCount() const
+{
+	return dropped;
+} // droppedCount
+
+// Takes the whole queue at once and writes it with the lock released, so log() only ever waits
+// for a push or a swap
+void TimingLog::writerLoop()
+{
+	std::vector<TimingRecord> batch;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		record_ready.wait(lock, [this] { return stopping || !queue.empty(); });
+		// Stopping only ends the loop once everything queued before it has been written
+		if (queue.empty())
+		{
+			return;
+		}
+		batch.assign(queue.begin(), queue.end());
+		queue.clear();
+		lock.unlock();
+
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			writeRecord(batch[i]);
+		}
+		// The file is up to date whenever the queue is empty
+		file.flush();
+
+		lock.lock();
+	}
+} // writerLoop
+
+void TimingLog::writeRecord(const TimingRecord& r)
+{
+	if (format == TIMING_JSON_LINES)
+	{
+		file << "{\"timestamp_ms\":" << r.timestamp_ms << ",\"width\":" << r.width << ",\"height\":" << r.height
+			<< ",\"max_iterations\":" << r.max_iterations << ",\"backend\":\"" << r.backend << "\",\"tile_size\":" << r.tile_size
+			<< ",\"input_ns\":" << r.input_ns << ",\"compute_ns\":" << r.compute_ns << ",\"colour_ns\":" << r.colour_ns
+			<< ",\"upload_ns\":" << r.upload_ns << "}\n";
+	}
+	else
+	{
+		file << r.timestamp_ms << ',' << r.width << ',' << r.height << ',' << r.max_iterations << ',' << r.backend << ','
+			<< r.tile_size << ',' << r.input_ns << ',' << r.compute_ns << ',' << r.colour_ns << ',' << r.upload_ns << '\n';
+	}
+} // writeRecord
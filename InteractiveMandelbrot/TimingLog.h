@@ -0,0 +1,74 @@
+#pragma once
+
+// Writes the timing log on a thread of its own, so the render thread never waits for the file.
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Rows waiting to be written at most. Past that new ones are dropped rather than held up behind the disk.
+#define TIMING_LOG_QUEUE 256
+
+// TimingRecord struct
+// One finished frame: a row of the CSV, or an object of the JSON lines
+struct TimingRecord
+{
+	// Milliseconds since the Unix epoch when it was shown
+	long long timestamp_ms;
+	int width, height;
+	int max_iterations;
+	// Computation mode, named like the batch renderer's --backend
+	const char* backend;
+	// Edge in pixels of the tiles the frame was split into, 0 for a mode that doesn't tile
+	int tile_size;
+	// Nanoseconds of each stage (FrameProfiler's, bar the HUD which is drawn after the row is written)
+	long long input_ns, compute_ns, colour_ns, upload_ns;
+};
+
+// Layout of the log, chosen by its file name
+enum TimingFormat
+{
+	// Header row then one row per frame
+	TIMING_CSV,
+	// One JSON object per line (.jsonl)
+	TIMING_JSON_LINES
+};
+
+// TimingLog class
+// Queues rows from the render thread and writes them from a thread of its own, a batch at a
+// time with one flush per batch instead of one per line. The queue is bounded: a row that
+// doesn't fit is counted and dropped, so logging never blocks rendering.
+class TimingLog
+{
+public:
+	TimingLog();
+	// Writes whatever is still queued, then stops the writer
+	~TimingLog();
+
+	// Start writing to path, as JSON lines if it ends in .jsonl and CSV otherwise.
+	// False if the file can't be opened, rows are then dropped.
+	bool open(const std::string& path);
+	// Queue a row without waiting for the file, false if it was dropped
+	bool log(const TimingRecord& record);
+	// Rows dropped because the queue was full or the file couldn't be opened
+	unsigned long long droppedCount() const;
+
+protected:
+	// Loop run by the writer thread, takes everything queued and writes it
+	void writerLoop();
+	void writeRecord(const TimingRecord& record);
+
+	std::ofstream file;
+	TimingFormat format;
+
+	std::mutex mutex;
+	std::condition_variable record_ready;
+	std::deque<TimingRecord> queue;
+	bool stopping;
+	std::atomic<unsigned long long> dropped;
+
+	std::thread writer;
+};
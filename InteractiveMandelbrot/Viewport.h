@@ -0,0 +1,62 @@
+#pragma once
+
+// The region of the complex plane a frame shows, shared by every backend.
+#include "FixedPoint.h"
+
+// Viewport struct
+// The centre is kept in fixed point so it stays exact however far in the view is zoomed,
+// the edges are stored relative to it as plain doubles since they shrink with the zoom.
+// Pixel (px, py) of a w x h frame is
+//   cx = x + left_ + px * (right_ - left_) / w
+//   cy = y + top_ + py * (bottom_ - top_) / h
+// which is the mapping gpu_amp_mandelbrot uses, just with the centre split out.
+struct Viewport
+{
+	FixedPoint x, y;
+	double left_, right_, top_, bottom_;
+};
+
+// The interactive program's view of centre (x, y), 3 units wide and 2.25 high at zoom 1
+inline Viewport make_viewport(const FixedPoint& x, const FixedPoint& y, double zoom)
+{
+	Viewport view;
+	view.x = x;
+	view.y = y;
+	view.left_ = -2.0 * zoom;
+	view.right_ = 1.0 * zoom;
+	view.top_ = 1.125 * zoom;
+	view.bottom_ = -1.125 * zoom;
+	return view;
+} // make_viewport
+
+// A view given by the positions of its edges, centred on (0, 0)
+inline Viewport make_viewport(double left_, double right_, double top_, double bottom_)
+{
+	Viewport view;
+	view.left_ = left_;
+	view.right_ = right_;
+	view.top_ = top_;
+	view.bottom_ = bottom_;
+	return view;
+} // make_viewport
+
+// Edges as absolute floats, what the float kernels (CPU and AMP) work from
+inline void viewport_edges(const Viewport& view, float& left_, float& right_, float& top_, float& bottom_)
+{
+	double x = to_double(view.x);
+	double y = to_double(view.y);
+	left_ = (float)(x + view.left_);
+	right_ = (float)(x + view.right_);
+	top_ = (float)(y + view.top_);
+	bottom_ = (float)(y + view.bottom_);
+} // viewport_edges
+
+// Distance between the centres of neighbouring pixels, the smaller of the two axes
+inline double viewport_pixel_spacing(const Viewport& view, int width, int height)
+{
+	double span_x = view.right_ - view.left_;
+	double span_y = view.top_ - view.bottom_;
+	double dx = (span_x < 0.0 ? -span_x : span_x) / width;
+	double dy = (span_y < 0.0 ? -span_y : span_y) / height;
+	return dx < dy ? dx : dy;
+} // viewport_pixel_spacing
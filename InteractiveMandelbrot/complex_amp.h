@@ -37,3 +37,20 @@ Complex1 c_mul(Complex1 c1, Complex1 c2) restrict(cpu, amp)
 	tmp.y = b*c + a*d;
 	return tmp;
 } // c_mul
+
+// Analytic test for the two largest parts of the set, every point inside them is in the set
+// so the escape-time loop can be skipped.
+// Main cardioid: q(q + (x - 1/4)) < y^2 / 4 where q = (x - 1/4)^2 + y^2
+// Period-2 bulb: (x + 1)^2 + y^2 < 1/16
+bool c_in_cardioid_or_bulb(Complex1 c) restrict(cpu, amp)
+{
+	float xq = c.x - 0.25f;
+	float y2 = c.y*c.y;
+	float q = xq*xq + y2;
+	if (q*(q + xq) < 0.25f*y2)
+	{
+		return true;
+	}
+	float xb = c.x + 1.0f;
+	return xb*xb + y2 < 0.0625f;
+} // c_in_cardioid_or_bulb
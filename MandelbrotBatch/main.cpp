@@ -0,0 +1,407 @@
+// Headless batch renderer
+// Computes one frame with the same backends as InteractiveMandelbrot and writes it
+// to a PNG/PPM, no window or GPU context needed. Prints how long the compute took so
+// it can be used to measure throughput on machines without a display.
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "CpuMandelbrot.h"
+#include "FrameBuffer.h"
+#include "ImageWriter.h"
+#include "PosterRenderer.h"
+
+// C++ AMP only exists in the Microsoft compiler
+#ifdef _MSC_VER
+#define BATCH_HAS_AMP 1
+#include "AmpMandelbrot.h"
+#endif
+
+typedef std::chrono::steady_clock the_batch_clock;
+
+// Everything that can be set from the command line, defaults match the interactive program
+struct BatchOptions
+{
+	int width = 640;
+	int height = 480;
+	int max_iterations = 500;
+	int red = 1, green = 1, blue = 1;
+	// Same meaning as X_Modifier_, Y_Modifier_ and zoom_ in Mandelbrot2
+	// Parsed to FixedPoint so deep zoom centres keep every digit given
+	FixedPoint x, y;
+	double zoom = 1.0;
+	// Set when the viewport is given as --left/--right/--top/--bottom instead
+	bool explicit_viewport = false;
+	double left_ = 0.0, right_ = 0.0, top_ = 0.0, bottom_ = 0.0;
+	std::string backend = "cpu";
+	unsigned threads = 0;
+	std::string simd = "auto";
+	std::string precision = "auto";
+	bool series = true;
+	int tile_size = CPU_TS;
+	float period_tolerance = 0.0f;
+	// Compute the frame with and without cycle detection and fail if any count differs
+	bool check_periodicity = false;
+	int repeat = 1;
+	std::string output = "mandelbrot.png";
+	// Above 0 renders out-of-core in bands using at most this much memory for them
+	int poster_memory_mb = 0;
+};
+
+// Print the command line options
+static void print_usage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --width N            image width (default 640)\n"
+		<< "  --height N           image height (default 480)\n"
+		<< "  --iterations N       MAX_ITERATIONS (default 500)\n"
+		<< "  --x F --y F          centre offset, as moved with WASD (default 0 0), any number of digits\n"
+		<< "  --zoom F             zoom factor, smaller is further in (default 1)\n"
+		<< "  --left F --right F --top F --bottom F\n"
+		<< "                       exact viewport, overrides --x/--y/--zoom\n"
+		<< "  --red N --green N --blue N\n"
+		<< "                       colour multipliers (default 1 1 1)\n"
+		<< "  --backend NAME       cpu, cpu-tiled, mariani-silver"
+#ifdef BATCH_HAS_AMP
+		<< ", amp, amp-tiled"
+#endif
+		<< " (default cpu)\n"
+		<< "  --threads N          CPU worker threads, 0 for one per hardware thread\n"
+		<< "  --simd NAME          auto, avx512, avx2 or scalar\n"
+		<< "  --precision NAME     auto, float, double, double-double or perturbation (CPU backends only)\n"
+		<< "  --series on|off      series approximation for perturbation frames (default on)\n"
+		<< "  --tile-size N        tile edge for cpu-tiled (default " << CPU_TS << ")\n"
+		<< "  --period-tolerance F turn on cycle detection with this tolerance\n"
+		<< "  --check-periodicity on|off\n"
+		<< "                       compute the frame with and without cycle detection instead and\n"
+		<< "                       exit with 1 if any count differs (CPU backends only)\n"
+		<< "  --repeat N           compute the frame N times and report each time\n"
+		<< "  --output FILE        .png or .ppm, \"none\" to skip writing (default mandelbrot.png)\n"
+		<< "  --poster-memory MB   render a band at a time into a .ppm, keeping the bands\n"
+		<< "                       under MB megabytes, for images too big for memory\n"
+		<< "                       (always computed on the CPU with the cpu-tiled kernels)\n";
+} // print_usage
+
+// Read the options, returns false (after saying why) on anything it doesn't understand
+static bool parse_arguments(int argc, char** argv, BatchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			print_usage(argv[0]);
+			exit(0);
+		}
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << "\n";
+			return false;
+		}
+		const char* value = argv[++i];
+
+		if (arg == "--width") options.width = atoi(value);
+		else if (arg == "--height") options.height = atoi(value);
+		else if (arg == "--iterations") options.max_iterations = atoi(value);
+		else if (arg == "--x" || arg == "--y")
+		{
+			if (!parse_fixed_point(value, arg == "--x" ? options.x : options.y))
+			{
+				std::cerr << "Can't read " << arg << " " << value << "\n";
+				return false;
+			}
+		}
+		else if (arg == "--zoom") options.zoom = atof(value);
+		else if (arg == "--left") { options.left_ = atof(value); options.explicit_viewport = true; }
+		else if (arg == "--right") { options.right_ = atof(value); options.explicit_viewport = true; }
+		else if (arg == "--top") { options.top_ = atof(value); options.explicit_viewport = true; }
+		else if (arg == "--bottom") { options.bottom_ = atof(value); options.explicit_viewport = true; }
+		else if (arg == "--red") options.red = atoi(value);
+		else if (arg == "--green") options.green = atoi(value);
+		else if (arg == "--blue") options.blue = atoi(value);
+		else if (arg == "--backend") options.backend = value;
+		else if (arg == "--threads") options.threads = (unsigned)atoi(value);
+		else if (arg == "--simd") options.simd = value;
+		else if (arg == "--precision") options.precision = value;
+		else if (arg == "--series") options.series = strcmp(value, "off") != 0;
+		else if (arg == "--tile-size") options.tile_size = atoi(value);
+		else if (arg == "--period-tolerance") options.period_tolerance = (float)atof(value);
+		else if (arg == "--check-periodicity") options.check_periodicity = strcmp(value, "off") != 0;
+		else if (arg == "--repeat") options.repeat = atoi(value);
+		else if (arg == "--output") options.output = value;
+		else if (arg == "--poster-memory") options.poster_memory_mb = atoi(value);
+		else
+		{
+			std::cerr << "Unknown option " << arg << "\n";
+			return false;
+		}
+	}
+
+	// A mistyped name would otherwise quietly run with auto
+	if (options.simd != "auto" && options.simd != "avx512" && options.simd != "avx2" && options.simd != "scalar")
+	{
+		std::cerr << "Unknown SIMD level " << options.simd << "\n";
+		return false;
+	}
+	if (options.precision != "auto" && options.precision != "float" && options.precision != "double"
+		&& options.precision != "double-double" && options.precision != "perturbation")
+	{
+		std::cerr << "Unknown precision " << options.precision << "\n";
+		return false;
+	}
+
+	if (options.width <= 0 || options.height <= 0 || options.max_iterations <= 0 || options.repeat <= 0)
+	{
+		std::cerr << "Width, height, iterations and repeat must be above 0\n";
+		return false;
+	}
+	return true;
+} // parse_arguments
+
+// Render the whole image a band at a time straight to disk, the full frame is never in memory
+static int render_poster(const BatchOptions& options, CpuMandelbrot& cpu_backend, const Viewport& view)
+{
+	size_t length = options.output.size();
+	if (length < 4 || options.output.compare(length - 4, 4, ".ppm") != 0)
+	{
+		std::cerr << "Poster output has to be a .ppm\n";
+		return 1;
+	}
+
+	PosterRenderer poster(cpu_backend);
+	poster.setMemoryBudget((size_t)options.poster_memory_mb * 1024 * 1024);
+
+	std::cout << "Rendering " << options.width << "x" << options.height << " poster at " << options.max_iterations
+		<< " iterations in bands of " << poster.bandHeight(options.width) << " rows ("
+		<< cpu_backend.threadCount() << " threads, " << simd_level_name(cpu_backend.simdLevel()) << ")\n";
+
+	the_batch_clock::time_point start = the_batch_clock::now();
+	bool ok = poster.render(options.output.c_str(), options.width, options.height, view, [](int rows_done, int rows)
+	{
+		std::cout << "\r" << rows_done << "/" << rows << " rows" << std::flush;
+	});
+	the_batch_clock::time_point end = the_batch_clock::now();
+	std::cout << "\n";
+
+	if (!ok)
+	{
+		std::cerr << "Could not write " << options.output << "\n";
+		return 1;
+	}
+
+	double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() / 1000.0;
+	std::cout << "Wrote " << options.output << " in " << seconds << " s, " << poster.bandCount() << " bands, "
+		<< poster.peakBytes() / (1024 * 1024) << " MB of band buffers\n";
+	std::cout << "Skipped (cardioid/bulb): " << poster.skippedPixels() << "\n";
+	return 0;
+} // render_poster
+
+// Compute a frame of counts with one of the CPU backends
+static void compute_cpu(const std::string& backend, CpuMandelbrot& cpu_backend, FrameBuffer& frame, const Viewport& view)
+{
+	if (backend == "cpu")
+	{
+		cpu_backend.cpu_mandelbrot(frame.data(), frame.width(), frame.height(), frame.stride(), view);
+	}
+	else if (backend == "cpu-tiled")
+	{
+		cpu_backend.cpu_mandelbrot_tiled(frame.data(), frame.width(), frame.height(), frame.stride(), view);
+	}
+	else if (backend == "mariani-silver")
+	{
+		cpu_backend.cpu_mandelbrot_mariani_silver(frame.data(), frame.width(), frame.height(), frame.stride(), view);
+	}
+} // compute_cpu
+
+// Cycle detection should only ever save time: compare the counts with it on and off
+static int check_periodicity(const BatchOptions& options, CpuMandelbrot& cpu_backend, FrameBuffer& frame, const Viewport& view)
+{
+	if (options.period_tolerance <= 0.0f)
+	{
+		std::cerr << "--check-periodicity needs a --period-tolerance\n";
+		return 1;
+	}
+
+	FrameBuffer reference;
+	reference.resize(frame.width(), frame.height());
+	cpu_backend.setPeriodicityCheck(0.0f);
+	compute_cpu(options.backend, cpu_backend, reference, view);
+	cpu_backend.setPeriodicityCheck(options.period_tolerance);
+	compute_cpu(options.backend, cpu_backend, frame, view);
+
+	long long different = 0;
+	for (int y = 0; y < frame.height(); y++)
+	{
+		const uint32_t* row = frame.row(y);
+		const uint32_t* reference_row = reference.row(y);
+		for (int x = 0; x < frame.width(); x++)
+		{
+			if (row[x] != reference_row[x])
+			{
+				if (different == 0)
+				{
+					std::cout << "First difference at (" << x << ", " << y << "): " << row[x]
+						<< " with cycle detection, " << reference_row[x] << " without\n";
+				}
+				different++;
+			}
+		}
+	}
+
+	std::cout << "Precision: " << precision_name(cpu_backend.precision()) << ", periodic: " << cpu_backend.periodicPixels()
+		<< ", different: " << different << " of " << (long long)frame.width() * frame.height() << "\n";
+	return different == 0 ? 0 : 1;
+} // check_periodicity
+
+int main(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!parse_arguments(argc, argv, options))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Same viewport the interactive program computes from its zoom and offsets
+	Viewport view = make_viewport(options.x, options.y, options.zoom);
+	if (options.explicit_viewport)
+	{
+		view = make_viewport(options.left_, options.right_, options.top_, options.bottom_);
+	}
+
+	CpuMandelbrot cpu_backend(options.threads);
+	cpu_backend.setMaxIterations(options.max_iterations);
+	cpu_backend.setColour(options.red, options.green, options.blue);
+	cpu_backend.setTileSize(options.tile_size);
+	cpu_backend.setPeriodicityCheck(options.period_tolerance);
+	if (options.simd == "scalar") cpu_backend.setSimdLevel(SIMD_SCALAR);
+	else if (options.simd == "avx2") cpu_backend.setSimdLevel(SIMD_AVX2);
+	else if (options.simd == "avx512") cpu_backend.setSimdLevel(SIMD_AVX512);
+	if (options.precision == "float") cpu_backend.setPrecision(PRECISION_FLOAT);
+	else if (options.precision == "double") cpu_backend.setPrecision(PRECISION_DOUBLE);
+	else if (options.precision == "double-double") cpu_backend.setPrecision(PRECISION_DOUBLE_DOUBLE);
+	else if (options.precision == "perturbation") cpu_backend.setPrecision(PRECISION_PERTURBATION);
+	cpu_backend.setSeriesApproximation(options.series);
+
+	if (options.poster_memory_mb > 0)
+	{
+		return render_poster(options, cpu_backend, view);
+	}
+
+#ifdef BATCH_HAS_AMP
+	AmpMandelbrot amp_backend;
+	amp_backend.setMaxIterations(options.max_iterations);
+#endif
+
+	bool is_cpu = options.backend == "cpu" || options.backend == "cpu-tiled" || options.backend == "mariani-silver";
+	bool is_amp = options.backend == "amp" || options.backend == "amp-tiled";
+#ifndef BATCH_HAS_AMP
+	if (is_amp)
+	{
+		std::cerr << "This build has no C++ AMP support\n";
+		return 1;
+	}
+#endif
+	if (!is_cpu && !is_amp)
+	{
+		std::cerr << "Unknown backend " << options.backend << "\n";
+		return 1;
+	}
+
+	FrameBuffer frame;
+	try
+	{
+		frame.resize(options.width, options.height);
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "Not enough memory for a " << options.width << "x" << options.height << " frame, try --poster-memory\n";
+		return 1;
+	}
+
+	if (options.check_periodicity)
+	{
+		if (!is_cpu)
+		{
+			std::cerr << "--check-periodicity needs a CPU backend\n";
+			return 1;
+		}
+		return check_periodicity(options, cpu_backend, frame, view);
+	}
+
+	std::cout << "Computing " << options.width << "x" << options.height << " at " << options.max_iterations
+		<< " iterations with " << options.backend;
+	if (is_cpu)
+	{
+		std::cout << " (" << cpu_backend.threadCount() << " threads, " << simd_level_name(cpu_backend.simdLevel()) << ")";
+	}
+	std::cout << "\n";
+
+	for (int run = 0; run < options.repeat; run++)
+	{
+		the_batch_clock::time_point start = the_batch_clock::now();
+		try
+		{
+			if (is_cpu)
+			{
+				compute_cpu(options.backend, cpu_backend, frame, view);
+			}
+#ifdef BATCH_HAS_AMP
+			else if (options.backend == "amp")
+			{
+				amp_backend.gpu_amp_mandelbrot(frame.data(), frame.width(), frame.height(), frame.stride(), view);
+			}
+			else if (options.backend == "amp-tiled")
+			{
+				amp_backend.gpu_amp_mandelbrot_tiled(frame.data(), frame.width(), frame.height(), frame.stride(), view);
+			}
+#endif
+		}
+		catch (const std::exception& ex)
+		{
+			std::cerr << "Error: " << ex.what() << "\n";
+			return 1;
+		}
+		the_batch_clock::time_point end = the_batch_clock::now();
+
+		// The frame holds iteration counts until it's coloured
+		cpu_backend.colour(frame.data(), frame.stride(), frame.data(), frame.stride(), frame.width(), frame.height());
+
+		double ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+		double mpixels = (double)options.width * options.height / 1e6;
+		std::cout << "Run " << run + 1 << ": " << ms << " ms, " << mpixels / (ms / 1000.0) << " Mpixel/s\n";
+	}
+
+	if (is_cpu)
+	{
+		std::cout << "Precision: " << precision_name(cpu_backend.precision()) << "\n";
+		if (cpu_backend.precision() == PRECISION_PERTURBATION)
+		{
+			std::cout << "Reference orbit: " << cpu_backend.referenceOrbit().length() - 1
+				<< " iterations, series skipped: " << cpu_backend.seriesSkip()
+				<< ", rebased: " << cpu_backend.rebasedCount() << "\n";
+		}
+		std::cout << "Skipped (cardioid/bulb): " << cpu_backend.skippedPixels()
+			<< ", periodic: " << cpu_backend.periodicPixels() << "\n";
+	}
+#ifdef BATCH_HAS_AMP
+	else
+	{
+		std::cout << "Skipped (cardioid/bulb): " << amp_backend.skippedPixels() << "\n";
+	}
+#endif
+
+	if (options.output != "none")
+	{
+		if (!write_image(options.output.c_str(), frame.data(), frame.width(), frame.height(), frame.stride()))
+		{
+			std::cerr << "Could not write " << options.output << "\n";
+			return 1;
+		}
+		std::cout << "Wrote " << options.output << "\n";
+	}
+	return 0;
+}
@@ -0,0 +1,558 @@
+// Benchmark suite
+// Times every combination of resolution, iteration count, backend and tile size with
+// warm-up runs and nanosecond timing, along with the colour passes on their own, and writes the statistics as JSON and/or CSV so
+// two builds can be compared with a diff. Replaces the old timeNonTiled/timeTiled loops.
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "CpuMandelbrot.h"
+#include "FrameBuffer.h"
+#include "Palette.h"
+#include "ThreadPool.h"
+
+// C++ AMP only exists in the Microsoft compiler
+#ifdef _MSC_VER
+#define BENCH_HAS_AMP 1
+#include "AmpMandelbrot.h"
+#endif
+
+typedef std::chrono::steady_clock the_bench_clock;
+
+// What to sweep and how, defaults cover the resolutions and iteration counts of the old CSV folders
+struct BenchmarkOptions
+{
+	std::vector<std::pair<int, int> > resolutions;
+	std::vector<int> iterations;
+	std::vector<std::string> backends;
+	std::vector<int> tile_sizes;
+	int warmup = 3;
+	int runs = 20;
+	unsigned threads = 0;
+	std::string simd = "auto";
+	std::string precision = "auto";
+	bool series = true;
+	float period_tolerance = 0.0f;
+	double x = 0.0, y = 0.0, zoom = 1.0;
+	std::string json_file;
+	std::string csv_file;
+};
+
+// Statistics for one combination, times in nanoseconds
+struct BenchmarkResult
+{
+	int width, height;
+	int iterations;
+	std::string backend;
+	// 0 for the backends that don't use tiles
+	int tile_size;
+	int runs;
+	long long min_ns, median_ns, p95_ns, p99_ns, max_ns;
+	double mean_ns;
+	// Pixels per second, and pixels x MAX_ITERATIONS per second (the worst-case work per second)
+	double mpixels_per_s;
+	double mpixel_iterations_per_s;
+	long long skipped_pixels;
+	// Iterations every pixel skipped with the series approximation (perturbation frames only)
+	unsigned series_skip;
+};
+
+// Print the command line options
+static void print_usage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --resolutions LIST   e.g. 640x480,1920x1080 (default 640x480,960x768,1280x960,1920x1280)\n"
+		<< "  --iterations LIST    e.g. 500,2500 (default 500,2500,5000)\n"
+		<< "  --backends LIST      cpu, cpu-tiled, mariani-silver"
+#ifdef BENCH_HAS_AMP
+		<< ", amp, amp-tiled"
+#endif
+		<< ",\n"
+		<< "                       colour-formula, colour-lut, colour-smooth, which time only the\n"
+		<< "                       colour pass over a frame of counts (default all)\n"
+		<< "  --tile-sizes LIST    tile edges for cpu-tiled and amp-tiled (default 4,8,16,32,64)\n"
+		<< "                       amp-tiled only runs the ones it has a kernel for (4, 8, 16, 32)\n"
+		<< "  --warmup N           untimed runs before each combination (default 3)\n"
+		<< "  --runs N             timed runs per combination (default 20)\n"
+		<< "  --threads N          CPU worker threads, 0 for one per hardware thread\n"
+		<< "  --simd NAME          auto, avx512, avx2 or scalar\n"
+		<< "  --precision NAME     auto, float, double, double-double or perturbation (CPU backends only)\n"
+		<< "  --series on|off      series approximation for perturbation frames (default on)\n"
+		<< "  --period-tolerance F turn on cycle detection with this tolerance\n"
+		<< "  --x F --y F --zoom F viewport, as in the interactive program (default 0 0 1)\n"
+		<< "  --json FILE          write the results as JSON\n"
+		<< "  --csv FILE           write the results as CSV\n";
+} // print_usage
+
+// Split a comma separated list
+static std::vector<std::string> split_list(const std::string& list)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty())
+		{
+			items.push_back(item);
+		}
+	}
+	return items;
+} // split_list
+
+// Read the options, returns false (after saying why) on anything it doesn't understand
+static bool parse_arguments(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			print_usage(argv[0]);
+			exit(0);
+		}
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << arg << "\n";
+			return false;
+		}
+		std::string value = argv[++i];
+
+		if (arg == "--resolutions")
+		{
+			options.resolutions.clear();
+			std::vector<std::string> items = split_list(value);
+			for (size_t j = 0; j < items.size(); j++)
+			{
+				int w = 0, h = 0;
+				size_t split = items[j].find('x');
+				if (split != std::string::npos)
+				{
+					w = atoi(items[j].substr(0, split).c_str());
+					h = atoi(items[j].substr(split + 1).c_str());
+				}
+				if (w <= 0 || h <= 0)
+				{
+					std::cerr << "Bad resolution " << items[j] << "\n";
+					return false;
+				}
+				options.resolutions.push_back(std::make_pair(w, h));
+			}
+		}
+		else if (arg == "--iterations" || arg == "--tile-sizes")
+		{
+			std::vector<int>& list = arg == "--iterations" ? options.iterations : options.tile_sizes;
+			list.clear();
+			std::vector<std::string> items = split_list(value);
+			for (size_t j = 0; j < items.size(); j++)
+			{
+				list.push_back(atoi(items[j].c_str()));
+			}
+		}
+		else if (arg == "--backends") options.backends = split_list(value);
+		else if (arg == "--warmup") options.warmup = atoi(value.c_str());
+		else if (arg == "--runs") options.runs = atoi(value.c_str());
+		else if (arg == "--threads") options.threads = (unsigned)atoi(value.c_str());
+		else if (arg == "--simd") options.simd = value;
+		else if (arg == "--precision") options.precision = value;
+		else if (arg == "--series") options.series = value != "off";
+		else if (arg == "--period-tolerance") options.period_tolerance = (float)atof(value.c_str());
+		else if (arg == "--x") options.x = atof(value.c_str());
+		else if (arg == "--y") options.y = atof(value.c_str());
+		else if (arg == "--zoom") options.zoom = atof(value.c_str());
+		else if (arg == "--json") options.json_file = value;
+		else if (arg == "--csv") options.csv_file = value;
+		else
+		{
+			std::cerr << "Unknown option " << arg << "\n";
+			return false;
+		}
+	}
+
+	// A mistyped name would otherwise quietly run with auto
+	if (options.simd != "auto" && options.simd != "avx512" && options.simd != "avx2" && options.simd != "scalar")
+	{
+		std::cerr << "Unknown SIMD level " << options.simd << "\n";
+		return false;
+	}
+	if (options.precision != "auto" && options.precision != "float" && options.precision != "double"
+		&& options.precision != "double-double" && options.precision != "perturbation")
+	{
+		std::cerr << "Unknown precision " << options.precision << "\n";
+		return false;
+	}
+
+	if (options.runs <= 0 || options.warmup < 0)
+	{
+		std::cerr << "Runs must be above 0 and warm-up can't be negative\n";
+		return false;
+	}
+	return true;
+} // parse_arguments
+
+// Sample at fraction p of the sorted times, nearest rank
+static long long percentile(const std::vector<long long>& sorted, double p)
+{
+	size_t rank = (size_t)(p * sorted.size() + 0.999999);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	if (rank > sorted.size())
+	{
+		rank = sorted.size();
+	}
+	return sorted[rank - 1];
+} // percentile
+
+// Which compiler built this, so results from different builds can be told apart
+static std::string compiler_name()
+{
+	std::stringstream name;
+#if defined(_MSC_VER)
+	name << "MSVC " << _MSC_VER;
+#elif defined(__clang__)
+	name << "Clang " << __clang_major__ << "." << __clang_minor__;
+#elif defined(__GNUC__)
+	name << "GCC " << __GNUC__ << "." << __GNUC_MINOR__;
+#else
+	name << "unknown";
+#endif
+	return name.str();
+} // compiler_name
+
+// Write every result as one JSON document
+static bool write_json(const std::string& filename, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options, const CpuMandelbrot& cpu_backend)
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+	{
+		return false;
+	}
+
+	file << std::setprecision(6) << std::fixed;
+	file << "{\n";
+	file << "  \"compiler\": \"" << compiler_name() << "\",\n";
+	file << "  \"threads\": " << cpu_backend.threadCount() << ",\n";
+	file << "  \"simd\": \"" << simd_level_name(cpu_backend.simdLevel()) << "\",\n";
+	file << "  \"warmup\": " << options.warmup << ",\n";
+	file << "  \"runs\": " << options.runs << ",\n";
+	file << "  \"precision\": \"" << precision_name(cpu_backend.precision()) << "\",\n";
+	// Deep zooms need every digit, fixed notation would print them as 0
+	file << std::setprecision(17) << std::scientific;
+	file << "  \"viewport\": { \"x\": " << options.x << ", \"y\": " << options.y << ", \"zoom\": " << options.zoom << " },\n";
+	file << std::setprecision(6) << std::fixed;
+	file << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		file << "    { \"width\": " << r.width << ", \"height\": " << r.height
+			<< ", \"iterations\": " << r.iterations << ", \"backend\": \"" << r.backend << "\""
+			<< ", \"tile_size\": " << r.tile_size << ", \"runs\": " << r.runs
+			<< ", \"min_ns\": " << r.min_ns << ", \"median_ns\": " << r.median_ns
+			<< ", \"p95_ns\": " << r.p95_ns << ", \"p99_ns\": " << r.p99_ns << ", \"max_ns\": " << r.max_ns
+			<< ", \"mean_ns\": " << r.mean_ns
+			<< ", \"mpixels_per_s\": " << r.mpixels_per_s
+			<< ", \"mpixel_iterations_per_s\": " << r.mpixel_iterations_per_s
+			<< ", \"skipped_pixels\": " << r.skipped_pixels
+			<< ", \"series_skip\": " << r.series_skip << " }"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n";
+	file << "}\n";
+	return (bool)file;
+} // write_json
+
+// Write every result as one CSV row
+static bool write_csv(const std::string& filename, const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(filename.c_str());
+	if (!file)
+	{
+		return false;
+	}
+
+	file << std::setprecision(6) << std::fixed;
+	file << "width,height,iterations,backend,tile_size,runs,min_ns,median_ns,p95_ns,p99_ns,max_ns,mean_ns,mpixels_per_s,mpixel_iterations_per_s,skipped_pixels,series_skip\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		file << r.width << "," << r.height << "," << r.iterations << "," << r.backend << "," << r.tile_size << "," << r.runs << ","
+			<< r.min_ns << "," << r.median_ns << "," << r.p95_ns << "," << r.p99_ns << "," << r.max_ns << "," << r.mean_ns << ","
+			<< r.mpixels_per_s << "," << r.mpixel_iterations_per_s << "," << r.skipped_pixels << "," << r.series_skip << "\n";
+	}
+	return (bool)file;
+} // write_csv
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	options.resolutions.push_back(std::make_pair(640, 480));
+	options.resolutions.push_back(std::make_pair(960, 768));
+	options.resolutions.push_back(std::make_pair(1280, 960));
+	options.resolutions.push_back(std::make_pair(1920, 1280));
+	options.iterations.push_back(500);
+	options.iterations.push_back(2500);
+	options.iterations.push_back(5000);
+	options.backends.push_back("cpu");
+	options.backends.push_back("cpu-tiled");
+	options.backends.push_back("mariani-silver");
+#ifdef BENCH_HAS_AMP
+	options.backends.push_back("amp");
+	options.backends.push_back("amp-tiled");
+#endif
+	options.backends.push_back("colour-formula");
+	options.backends.push_back("colour-lut");
+	options.backends.push_back("colour-smooth");
+	int default_tiles[] = { 4, 8, 16, 32, 64 };
+	options.tile_sizes.assign(default_tiles, default_tiles + 5);
+
+	if (!parse_arguments(argc, argv, options))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	Viewport view = make_viewport(options.x, options.y, options.zoom);
+
+	CpuMandelbrot cpu_backend(options.threads);
+	cpu_backend.setPeriodicityCheck(options.period_tolerance);
+	if (options.simd == "scalar") cpu_backend.setSimdLevel(SIMD_SCALAR);
+	else if (options.simd == "avx2") cpu_backend.setSimdLevel(SIMD_AVX2);
+	else if (options.simd == "avx512") cpu_backend.setSimdLevel(SIMD_AVX512);
+	if (options.precision == "float") cpu_backend.setPrecision(PRECISION_FLOAT);
+	else if (options.precision == "double") cpu_backend.setPrecision(PRECISION_DOUBLE);
+	else if (options.precision == "double-double") cpu_backend.setPrecision(PRECISION_DOUBLE_DOUBLE);
+	else if (options.precision == "perturbation") cpu_backend.setPrecision(PRECISION_PERTURBATION);
+	cpu_backend.setSeriesApproximation(options.series);
+#ifdef BENCH_HAS_AMP
+	AmpMandelbrot amp_backend;
+#endif
+	// The colour passes run a row per task like CpuMandelbrot::colour, on a pool of their own
+	// so the formula, lookup table and smooth lookups all get the same threads
+	ThreadPool colour_pool(options.threads);
+	Palette palette;
+	bool colour_backends = false;
+	for (size_t be = 0; be < options.backends.size(); be++)
+	{
+		colour_backends = colour_backends || options.backends[be].compare(0, 7, "colour-") == 0;
+	}
+
+	std::cout << compiler_name() << ", " << cpu_backend.threadCount() << " threads, " << simd_level_name(cpu_backend.simdLevel())
+		<< ", " << options.warmup << " warm-up + " << options.runs << " timed runs each\n";
+	std::cout << std::left << std::setw(11) << "resolution" << std::setw(7) << "iters" << std::setw(16) << "backend" << std::setw(6) << "tile"
+		<< std::right << std::setw(12) << "median ms" << std::setw(12) << "p95 ms" << std::setw(12) << "p99 ms" << std::setw(12) << "Mpix/s" << std::setw(14) << "Mpix-iter/s" << "\n";
+
+	std::vector<BenchmarkResult> results;
+	FrameBuffer frame;
+	// Counts the colour passes map, and the same counts with a fraction for the smooth lookups
+	FrameBuffer colour_counts;
+	std::vector<float> smooth_counts;
+	for (size_t res = 0; res < options.resolutions.size(); res++)
+	{
+		int width = options.resolutions[res].first;
+		int height = options.resolutions[res].second;
+		try
+		{
+			frame.resize(width, height);
+			if (colour_backends)
+			{
+				colour_counts.resize(width, height);
+				smooth_counts.resize((size_t)width * height);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			std::cerr << "Not enough memory for " << width << "x" << height << ", skipped\n";
+			continue;
+		}
+
+		for (size_t it = 0; it < options.iterations.size(); it++)
+		{
+			int iterations = options.iterations[it];
+			cpu_backend.setMaxIterations(iterations);
+#ifdef BENCH_HAS_AMP
+			amp_backend.setMaxIterations(iterations);
+#endif
+			// A real frame for the colour passes to map, its time isn't counted
+			if (colour_backends)
+			{
+				cpu_backend.cpu_mandelbrot(colour_counts.data(), width, height, colour_counts.stride(), view);
+				for (int y = 0; y < height; y++)
+				{
+					const uint32_t* row = colour_counts.row(y);
+					for (int x = 0; x < width; x++)
+					{
+						// The time doesn't depend on the fractions, half way between each pair of counts
+						smooth_counts[(size_t)y * width + x] = row[x] < (unsigned)iterations ? row[x] + 0.5f : (float)row[x];
+					}
+				}
+				palette.build(iterations, 1, 1, 1);
+			}
+
+			for (size_t be = 0; be < options.backends.size(); be++)
+			{
+				const std::string& backend = options.backends[be];
+				bool tiled = backend == "cpu-tiled" || backend == "amp-tiled";
+
+				// Backends without tiles run once, with a tile size of 0
+				std::vector<int> tile_sizes = tiled ? options.tile_sizes : std::vector<int>(1, 0);
+				for (size_t ts = 0; ts < tile_sizes.size(); ts++)
+				{
+					int tile_size = tile_sizes[ts];
+					if (backend == "amp-tiled" && tile_size != 4 && tile_size != 8 && tile_size != 16 && tile_size != 32)
+					{
+						continue;
+					}
+					cpu_backend.setTileSize(tile_size);
+#ifdef BENCH_HAS_AMP
+					amp_backend.setTileSize(tile_size);
+#endif
+
+					std::vector<long long> samples;
+					long long skipped = 0;
+					bool failed = false;
+					for (int run = 0; run < options.warmup + options.runs && !failed; run++)
+					{
+						the_bench_clock::time_point start = the_bench_clock::now();
+						try
+						{
+							if (backend == "cpu")
+							{
+								cpu_backend.cpu_mandelbrot(frame.data(), width, height, frame.stride(), view);
+								skipped = cpu_backend.skippedPixels();
+							}
+							else if (backend == "cpu-tiled")
+							{
+								cpu_backend.cpu_mandelbrot_tiled(frame.data(), width, height, frame.stride(), view);
+								skipped = cpu_backend.skippedPixels();
+							}
+							else if (backend == "mariani-silver")
+							{
+								cpu_backend.cpu_mandelbrot_mariani_silver(frame.data(), width, height, frame.stride(), view);
+								skipped = cpu_backend.skippedPixels();
+							}
+							else if (backend == "colour-formula")
+							{
+								colour_pool.parallel_for(height, [&](int y)
+								{
+									colour_row(colour_counts.row(y), frame.row(y), width, iterations, 1, 1, 1);
+								});
+							}
+							else if (backend == "colour-lut")
+							{
+								colour_pool.parallel_for(height, [&](int y)
+								{
+									palette_row(cpu_backend.simdLevel(), palette, colour_counts.row(y), frame.row(y), width);
+								});
+							}
+							else if (backend == "colour-smooth")
+							{
+								colour_pool.parallel_for(height, [&](int y)
+								{
+									palette_row_smooth(cpu_backend.simdLevel(), palette, smooth_counts.data() + (size_t)y * width, frame.row(y), width);
+								});
+							}
+#ifdef BENCH_HAS_AMP
+							else if (backend == "amp")
+							{
+								amp_backend.gpu_amp_mandelbrot(frame.data(), width, height, frame.stride(), view);
+								skipped = amp_backend.skippedPixels();
+							}
+							else if (backend == "amp-tiled")
+							{
+								amp_backend.gpu_amp_mandelbrot_tiled(frame.data(), width, height, frame.stride(), view);
+								skipped = amp_backend.skippedPixels();
+							}
+#endif
+							else
+							{
+								std::cerr << "Unknown backend " << backend << ", skipped\n";
+								failed = true;
+							}
+						}
+						catch (const std::exception& ex)
+						{
+							std::cerr << backend << " failed: " << ex.what() << "\n";
+							failed = true;
+						}
+						the_bench_clock::time_point end = the_bench_clock::now();
+
+						if (run >= options.warmup)
+						{
+							samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+						}
+					}
+					if (failed)
+					{
+						break;
+					}
+
+					std::sort(samples.begin(), samples.end());
+					double total = 0.0;
+					for (size_t i = 0; i < samples.size(); i++)
+					{
+						total += (double)samples[i];
+					}
+
+					BenchmarkResult result;
+					result.width = width;
+					result.height = height;
+					result.iterations = iterations;
+					result.backend = backend;
+					result.tile_size = tile_size;
+					result.runs = (int)samples.size();
+					result.min_ns = samples.front();
+					result.median_ns = percentile(samples, 0.5);
+					result.p95_ns = percentile(samples, 0.95);
+					result.p99_ns = percentile(samples, 0.99);
+					result.max_ns = samples.back();
+					result.mean_ns = total / samples.size();
+					double pixels = (double)width * height;
+					result.mpixels_per_s = pixels / result.median_ns * 1e3;
+					// The colour passes cost the same whatever the iteration count, 0 rather than a made up figure
+					bool is_colour = backend.compare(0, 7, "colour-") == 0;
+					result.mpixel_iterations_per_s = is_colour ? 0.0 : pixels * iterations / result.median_ns * 1e3;
+					result.skipped_pixels = skipped;
+					bool is_cpu = backend == "cpu" || backend == "cpu-tiled" || backend == "mariani-silver";
+					result.series_skip = is_cpu && cpu_backend.precision() == PRECISION_PERTURBATION ? cpu_backend.seriesSkip() : 0;
+					results.push_back(result);
+
+					std::stringstream resolution;
+					resolution << width << "x" << height;
+					std::cout << std::left << std::setw(11) << resolution.str() << std::setw(7) << iterations << std::setw(16) << backend << std::setw(6) << tile_size
+						<< std::right << std::fixed << std::setprecision(3)
+						<< std::setw(12) << result.median_ns / 1e6 << std::setw(12) << result.p95_ns / 1e6 << std::setw(12) << result.p99_ns / 1e6
+						<< std::setprecision(1) << std::setw(12) << result.mpixels_per_s << std::setw(14);
+					if (is_colour)
+					{
+						std::cout << "-" << "\n";
+					}
+					else
+					{
+						std::cout << result.mpixel_iterations_per_s << "\n";
+					}
+				}
+			}
+		}
+	}
+
+	if (!options.json_file.empty() && !write_json(options.json_file, results, options, cpu_backend))
+	{
+		std::cerr << "Could not write " << options.json_file << "\n";
+		return 1;
+	}
+	if (!options.csv_file.empty() && !write_csv(options.csv_file, results))
+	{
+		std::cerr << "Could not write " << options.csv_file << "\n";
+		return 1;
+	}
+	return 0;
+}